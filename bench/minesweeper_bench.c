@@ -0,0 +1,422 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <minesweeper.h>
+#include <minesweeper_parallel.h>
+#include <minesweeper_replay.h>
+#include <minesweeper_metrics.h>
+#include <minesweeper_cursor.h>
+#include <minesweeper_overview.h>
+#include <minesweeper_delta.h>
+
+/* Benchmarks for large boards. Run with `make run-benchmarks`. */
+
+static double now(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**
+ * Find a tile to click that starts a cascade, scanning
+ * from the center of the board.
+ */
+static struct minesweeper_tile *find_empty_tile(struct minesweeper_game *game) {
+	unsigned x;
+	for (x = game->width / 2; x < game->width; x++) {
+		struct minesweeper_tile *tile = minesweeper_get_tile_at(game, x, game->height / 2);
+		if (!tile->has_mine && tile->adjacent_mine_count == 0)
+			return tile;
+	}
+	return minesweeper_get_tile_at(game, game->width / 2, game->height / 2);
+}
+
+static void bench_options(const char *name, unsigned size, float density, unsigned options) {
+	uint8_t *buffer = malloc(minesweeper_buffer_size_with_options(size, size, options));
+	struct minesweeper_game *game;
+	double generation_time, cascade_time;
+	double start;
+
+	srand(1);
+	start = now();
+	game = minesweeper_init_with_options(size, size, density, options, buffer);
+	generation_time = now() - start;
+
+	start = now();
+	minesweeper_open_tile(game, find_empty_tile(game));
+	cascade_time = now() - start;
+
+	printf("%-10s %6ux%-6u density %.3f: generation %8.3f ms, cascade %8.3f ms (%u tiles opened)\n",
+		name, size, size, density, generation_time * 1000, cascade_time * 1000, game->opened_tile_count);
+	free(buffer);
+}
+
+/**
+ * Opens the same cascade as bench_options(), with thread_count threads,
+ * or with minesweeper_open_tile() if thread_count is 0. Returns the time
+ * taken. With track_changes, the opened tiles are also recorded in a
+ * change tracker.
+ */
+static double time_cascade(unsigned size, float density, unsigned thread_count, bool track_changes) {
+	uint8_t *buffer = malloc(minesweeper_minimum_buffer_size(size, size));
+	uint8_t *tracker_buffer = malloc(minesweeper_change_tracker_buffer_size(size, size));
+	struct minesweeper_game *game;
+	double start, cascade_time;
+
+	srand(1);
+	game = minesweeper_init(size, size, density, buffer);
+	if (track_changes)
+		minesweeper_track_changes(game, tracker_buffer);
+	start = now();
+	if (thread_count == 0)
+		minesweeper_open_tile(game, find_empty_tile(game));
+	else
+		minesweeper_open_tile_parallel(game, find_empty_tile(game), thread_count);
+	cascade_time = now() - start;
+	free(tracker_buffer);
+	free(buffer);
+	return cascade_time;
+}
+
+/**
+ * Compares parallel cascades to the serial one. A speedup above 1 needs
+ * at least as many CPU cores as threads, so the core count is printed too.
+ */
+static void bench_parallel_cascade(unsigned size, float density, const unsigned *thread_counts, unsigned count, bool track_changes) {
+	double serial_time = time_cascade(size, density, 0, track_changes);
+	unsigned i;
+	printf("serial     %6ux%-6u density %.3f:            cascade %8.3f ms%s\n",
+		size, size, density, serial_time * 1000, track_changes ? ", tracking changes" : "");
+	for (i = 0; i < count; i++) {
+		double parallel_time = time_cascade(size, density, thread_counts[i], track_changes);
+		printf("parallel   %6ux%-6u density %.3f: %2u threads, cascade %8.3f ms, %5.2fx speedup on %ld cores%s\n",
+			size, size, density, thread_counts[i], parallel_time * 1000, serial_time / parallel_time,
+			sysconf(_SC_NPROCESSORS_ONLN), track_changes ? ", tracking changes" : "");
+	}
+}
+
+#define EXPERT_WIDTH 30
+#define EXPERT_HEIGHT 16
+#define EXPERT_DENSITY (99.0f / (EXPERT_WIDTH * EXPERT_HEIGHT))
+#define REPLAY_COUNT 20000
+#define REPLAY_TARGET_RATE 200000
+
+/**
+ * Record winning expert games, opening the tiles without mines in a
+ * random order, so that most of them are opened by cascades.
+ */
+static struct minesweeper_replay *record_replays(struct minesweeper_action *actions) {
+	struct minesweeper_replay *replays = malloc(sizeof(struct minesweeper_replay) * REPLAY_COUNT);
+	uint8_t *buffer = malloc(minesweeper_buffer_size_with_options(EXPERT_WIDTH, EXPERT_HEIGHT, MINESWEEPER_DEFERRED_GENERATION));
+	unsigned r;
+	for (r = 0; r < REPLAY_COUNT; r++) {
+		struct minesweeper_game *game = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, MINESWEEPER_DEFERRED_GENERATION, r, buffer);
+		struct minesweeper_replay *replay = &replays[r];
+		replay->width = EXPERT_WIDTH;
+		replay->height = EXPERT_HEIGHT;
+		replay->mine_density = EXPERT_DENSITY;
+		replay->options = MINESWEEPER_DEFERRED_GENERATION;
+		replay->seed = r;
+		replay->actions = actions;
+		replay->timestamps = NULL;
+		replay->action_count = 0;
+		while (game->state != MINESWEEPER_WIN) {
+			unsigned x = rand() % EXPERT_WIDTH, y = rand() % EXPERT_HEIGHT;
+			struct minesweeper_tile *tile = minesweeper_get_tile_at(game, x, y);
+			if (tile->is_opened || (tile->has_mine && game->state != MINESWEEPER_PENDING_START))
+				continue;
+			actions->type = MINESWEEPER_ACTION_OPEN;
+			actions->x = x;
+			actions->y = y;
+			actions++;
+			replay->action_count++;
+			minesweeper_open_tile(game, tile);
+		}
+		replay->claimed_state = MINESWEEPER_WIN;
+	}
+	free(buffer);
+	return replays;
+}
+
+/**
+ * Verify the replays one at a time on a single thread, the rate a single
+ * core reaches, and compare it with the rate the server needs per core.
+ */
+static void bench_single_replays(struct minesweeper_replay *replays) {
+	uint8_t *buffer = malloc(minesweeper_replay_buffer_size(&replays[0]));
+	double start, verify_time, rate;
+	unsigned i, valid_count = 0, action_count = 0;
+
+	start = now();
+	for (i = 0; i < REPLAY_COUNT; i++) {
+		valid_count += minesweeper_verify_replay(&replays[i], buffer) == MINESWEEPER_REPLAY_VALID;
+	}
+	verify_time = now() - start;
+	for (i = 0; i < REPLAY_COUNT; i++) {
+		action_count += replays[i].action_count;
+	}
+	rate = REPLAY_COUNT / verify_time;
+
+	printf("replay     %6ux%-6u %u games: %8.0f games/s, %5.1f ns per action, target %u games/s (%.2fx) (%u valid)\n",
+		EXPERT_WIDTH, EXPERT_HEIGHT, REPLAY_COUNT, rate, verify_time * 1e9 / action_count,
+		REPLAY_TARGET_RATE, rate / REPLAY_TARGET_RATE, valid_count);
+	free(buffer);
+}
+
+static void bench_replays(struct minesweeper_replay *replays, unsigned thread_count) {
+	enum minesweeper_replay_verdict *verdicts = malloc(sizeof(enum minesweeper_replay_verdict) * REPLAY_COUNT);
+	double start, verify_time;
+	unsigned i, valid_count = 0;
+
+	start = now();
+	minesweeper_verify_replays(replays, REPLAY_COUNT, verdicts, thread_count);
+	verify_time = now() - start;
+	for (i = 0; i < REPLAY_COUNT; i++) {
+		valid_count += verdicts[i] == MINESWEEPER_REPLAY_VALID;
+	}
+
+	printf("replays    %6ux%-6u %u games: %2u threads, %8.0f games/s (%u valid)\n",
+		EXPERT_WIDTH, EXPERT_HEIGHT, REPLAY_COUNT, thread_count, REPLAY_COUNT / verify_time, valid_count);
+	free(verdicts);
+}
+
+static void bench_metrics(unsigned thread_count) {
+	struct minesweeper_game **games = malloc(sizeof(struct minesweeper_game *) * REPLAY_COUNT);
+	struct minesweeper_metrics *metrics = malloc(sizeof(struct minesweeper_metrics) * REPLAY_COUNT);
+	size_t buffer_size = minesweeper_minimum_buffer_size(EXPERT_WIDTH, EXPERT_HEIGHT);
+	uint8_t *buffers = malloc(buffer_size * REPLAY_COUNT);
+	double start, metrics_time, bbbv_sum = 0;
+	unsigned i;
+
+	for (i = 0; i < REPLAY_COUNT; i++) {
+		games[i] = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, 0, i, buffers + i * buffer_size);
+	}
+	start = now();
+	minesweeper_compute_metrics_parallel(games, REPLAY_COUNT, metrics, thread_count);
+	metrics_time = now() - start;
+	for (i = 0; i < REPLAY_COUNT; i++) {
+		bbbv_sum += metrics[i].bbbv;
+	}
+
+	printf("metrics    %6ux%-6u %u boards: %2u threads, %8.0f boards/s (average 3BV %.1f)\n",
+		EXPERT_WIDTH, EXPERT_HEIGHT, REPLAY_COUNT, thread_count, REPLAY_COUNT / metrics_time, bbbv_sum / REPLAY_COUNT);
+	free(buffers);
+	free(metrics);
+	free(games);
+}
+
+/**
+ * Jump through the unopened tiles left after a cascade on a board with
+ * few mines, which are few and far apart.
+ */
+static void bench_cursor_jumps(unsigned size, unsigned jump_count) {
+	uint8_t *buffer = malloc(minesweeper_minimum_buffer_size(size, size));
+	uint8_t *index_buffer = malloc(minesweeper_cursor_index_buffer_size(size, size));
+	struct minesweeper_game *game;
+	double start, scan_time, index_time;
+	unsigned i;
+
+	srand(1);
+	game = minesweeper_init(size, size, 0.001f, buffer);
+	minesweeper_open_tile(game, find_empty_tile(game));
+
+	start = now();
+	for (i = 0; i < jump_count; i++) {
+		minesweeper_jump_cursor(game, MINESWEEPER_UNOPENED_TILE, false, true);
+	}
+	scan_time = now() - start;
+
+	minesweeper_index_cursor_jumps(game, index_buffer);
+	game->selected_tile = NULL;
+	start = now();
+	for (i = 0; i < jump_count; i++) {
+		minesweeper_jump_cursor(game, MINESWEEPER_UNOPENED_TILE, false, true);
+	}
+	index_time = now() - start;
+
+	printf("jumps      %6ux%-6u %u unopened tiles: scanning %8.3f us, indexed %8.3f us per jump\n",
+		size, size, size * size - game->opened_tile_count, scan_time * 1e6 / jump_count, index_time * 1e6 / jump_count);
+	free(index_buffer);
+	free(buffer);
+}
+
+/**
+ * Draws a minimap of frame_count frames, with a few flags placed between
+ * frames, by counting the opened tiles of each pixel from the tiles, and
+ * from an overview.
+ */
+static void bench_overview(unsigned size, unsigned map_size, unsigned frame_count) {
+	uint8_t *buffer = malloc(minesweeper_minimum_buffer_size(size, size));
+	uint8_t *overview_buffer = malloc(minesweeper_overview_buffer_size(size, size));
+	uint32_t *pixels = malloc(sizeof(uint32_t) * map_size * map_size);
+	unsigned pixel_size = size / map_size, frame, i, x, y;
+	struct minesweeper_game *game;
+	double start, scan_time, overview_time;
+
+	srand(1);
+	game = minesweeper_init(size, size, 0.01f, buffer);
+	minesweeper_open_tile(game, find_empty_tile(game));
+
+	start = now();
+	for (frame = 0; frame < frame_count; frame++) {
+		for (i = 0; i < 16; i++) {
+			minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, rand() % size, rand() % size));
+		}
+		memset(pixels, 0, sizeof(uint32_t) * map_size * map_size);
+		for (y = 0; y < size; y++) {
+			for (x = 0; x < size; x++) {
+				pixels[y / pixel_size * map_size + x / pixel_size] += minesweeper_get_tile_at(game, x, y)->is_opened;
+			}
+		}
+	}
+	scan_time = now() - start;
+
+	minesweeper_track_overview(game, overview_buffer);
+	start = now();
+	for (frame = 0; frame < frame_count; frame++) {
+		unsigned level = minesweeper_overview_level_for_size(game, map_size, map_size), width, height;
+		const struct minesweeper_tile_counts *cells;
+		for (i = 0; i < 16; i++) {
+			minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, rand() % size, rand() % size));
+		}
+		cells = minesweeper_get_overview(game, level, &width, &height);
+		for (i = 0; i < width * height; i++) {
+			pixels[i] = cells[i].opened;
+		}
+	}
+	overview_time = now() - start;
+
+	printf("overview   %6ux%-6u %ux%u minimap: scanning tiles %8.3f ms, overview %8.3f ms per frame\n",
+		size, size, map_size, map_size, scan_time * 1e3 / frame_count, overview_time * 1e3 / frame_count);
+	free(pixels);
+	free(overview_buffer);
+	free(buffer);
+}
+
+/**
+ * Syncs a mirror with delta messages, first for a cascade that opens
+ * most of the board, then for frames that only toggle a few flags.
+ */
+static void bench_delta(unsigned size, unsigned frame_count) {
+	uint8_t *buffer = malloc(minesweeper_minimum_buffer_size(size, size));
+	uint8_t *mirror_buffer = malloc(minesweeper_minimum_buffer_size(size, size));
+	uint8_t *tracker_buffer = malloc(minesweeper_change_tracker_buffer_size(size, size));
+	struct minesweeper_game *game, *mirror;
+	size_t changed_count, max_size, message_size, frame_bytes = 0;
+	uint8_t *message;
+	double start, encode_time, decode_time, frame_encode_time = 0, frame_decode_time = 0;
+	unsigned frame, i;
+
+	srand(1);
+	game = minesweeper_init(size, size, 0.01f, buffer);
+	mirror = minesweeper_init(size, size, 0.0f, mirror_buffer);
+	minesweeper_track_changes(game, tracker_buffer);
+	minesweeper_open_tile(game, find_empty_tile(game));
+
+	changed_count = game->change_tracker->changed_tile_count;
+	max_size = minesweeper_delta_max_size(game);
+	message = malloc(max_size);
+	start = now();
+	message_size = minesweeper_delta_encode(game, 0, message, max_size);
+	encode_time = now() - start;
+	start = now();
+	if (!minesweeper_delta_decode(mirror, message, message_size, NULL))
+		puts("delta: cascade message rejected");
+	decode_time = now() - start;
+
+	printf("delta      %6ux%-6u cascade of %lu tiles: %lu bytes (max %lu), encode %8.3f ms, decode %8.3f ms\n",
+		size, size, (unsigned long)changed_count, (unsigned long)message_size, (unsigned long)max_size,
+		encode_time * 1e3, decode_time * 1e3);
+
+	for (frame = 0; frame < frame_count; frame++) {
+		for (i = 0; i < 16;) {
+			struct minesweeper_tile *tile = minesweeper_get_tile_at(game, rand() % size, rand() % size);
+			if (tile->is_opened)
+				continue;
+			minesweeper_toggle_flag(game, tile);
+			i++;
+		}
+		start = now();
+		message_size = minesweeper_delta_encode(game, frame + 1, message, max_size);
+		frame_encode_time += now() - start;
+		start = now();
+		if (!minesweeper_delta_decode(mirror, message, message_size, NULL))
+			puts("delta: frame message rejected");
+		frame_decode_time += now() - start;
+		frame_bytes += message_size;
+	}
+
+	printf("delta      %6ux%-6u 16 flags per frame: %lu bytes, encode %8.3f ms, decode %8.3f ms per frame\n",
+		size, size, (unsigned long)(frame_bytes / frame_count),
+		frame_encode_time * 1e3 / frame_count, frame_decode_time * 1e3 / frame_count);
+	free(message);
+	free(tracker_buffer);
+	free(mirror_buffer);
+	free(buffer);
+}
+
+/**
+ * Opens a huge area with a budget of max_tiles per frame, and reports
+ * the slowest frame next to the total time.
+ */
+static void bench_budgeted_cascade(unsigned size, unsigned max_tiles) {
+	uint8_t *buffer = malloc(minesweeper_minimum_buffer_size(size, size));
+	struct minesweeper_game *game;
+	double start, frame_start, frame_time, slowest_frame = 0;
+	unsigned frame_count = 0;
+	bool is_done = false;
+
+	srand(1);
+	game = minesweeper_init(size, size, 0.01f, buffer);
+	start = now();
+	while (!is_done) {
+		frame_start = now();
+		if (frame_count++ == 0)
+			is_done = minesweeper_open_tile_with_budget(game, find_empty_tile(game), max_tiles);
+		else
+			is_done = minesweeper_continue_cascade(game, max_tiles);
+		frame_time = now() - frame_start;
+		if (frame_time > slowest_frame)
+			slowest_frame = frame_time;
+	}
+
+	printf("budgeted   %6ux%-6u %u tiles per frame: %u frames, slowest %8.3f ms, total %8.3f ms\n",
+		size, size, max_tiles, frame_count, slowest_frame * 1000, (now() - start) * 1000);
+	free(buffer);
+}
+
+int main(void) {
+	unsigned sizes[] = { 1024, 2048, 4096, 8192 };
+	unsigned thread_counts[] = { 1, 2, 4, 8 };
+	struct minesweeper_action *replay_actions;
+	struct minesweeper_replay *replays;
+	unsigned i;
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		bench_options("default", sizes[i], 0.01f, 0);
+		bench_options("labelled", sizes[i], 0.01f, MINESWEEPER_LABEL_ZERO_REGIONS);
+	}
+	bench_parallel_cascade(8192, 0.01f, thread_counts, sizeof(thread_counts) / sizeof(thread_counts[0]), false);
+	bench_parallel_cascade(8192, 0.01f, thread_counts, sizeof(thread_counts) / sizeof(thread_counts[0]), true);
+	bench_budgeted_cascade(4096, 100000);
+
+	replay_actions = malloc(sizeof(struct minesweeper_action) * REPLAY_COUNT * EXPERT_WIDTH * EXPERT_HEIGHT);
+	replays = record_replays(replay_actions);
+	bench_single_replays(replays);
+	for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+		bench_replays(replays, thread_counts[i]);
+	}
+	free(replays);
+	free(replay_actions);
+
+	for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+		bench_metrics(thread_counts[i]);
+	}
+
+	bench_cursor_jumps(8192, 1000);
+	bench_overview(8192, 256, 10);
+	bench_delta(4096, 100);
+	return 0;
+}
@@ -19,15 +19,96 @@ enum minesweeper_game_state {
 	MINESWEEPER_GAME_OVER
 };
 
+/**
+ * Optional features for minesweeper_init_with_options(), which
+ * can be combined with bitwise OR.
+ */
+enum minesweeper_options {
+	/* Keep a count of flagged adjacent tiles for every tile in
+	 * game->adjacent_flag_counts, which makes quick-opening
+	 * (chording) a single comparison. Uses one extra byte per tile. */
+	MINESWEEPER_TRACK_ADJACENT_FLAGS = 1 << 0,
+
+	/* Label connected regions of tiles without adjacent mines, so that
+	 * opening one of them opens the whole region and its border in a
+	 * single pass, instead of by cascading. The board is labelled on the
+	 * first cascade after mines are placed or moved, which then takes
+	 * about as long as opening the whole board. Only the first
+	 * MINESWEEPER_MAX_ZERO_REGIONS regions of at least
+	 * MINESWEEPER_MIN_LABELLED_REGION_SIZE tiles are labelled. Uses two
+	 * extra bytes per tile. Has no effect with MINESWEEPER_TORUS or
+	 * MINESWEEPER_HEX. */
+	MINESWEEPER_LABEL_ZERO_REGIONS = 1 << 2,
+
+	/* Don't place mines until the first tile is opened, and then keep
+	 * that tile and its adjacent tiles free of mines, so the first click
+	 * always starts a cascade. Exactly width * height * mine_density
+	 * mines are placed, which mine_count holds from the start. Makes
+	 * init instant on large boards. Don't place mines yourself with
+	 * minesweeper_toggle_mine() before the first tile is opened. */
+	MINESWEEPER_DEFERRED_GENERATION = 1 << 3,
+
+	/* Wrap the board around at its edges, so that tiles on opposite
+	 * edges are adjacent, and the cursor always wraps. The board must
+	 * be at least 3x3, or init returns NULL. */
+	MINESWEEPER_TORUS = 1 << 4,
+
+	/* Hexagonal tiles with 6 adjacent tiles each. Rows are laid out as
+	 * usual, with every odd row shifted half a tile to the right, so the
+	 * tiles above and below (x, y) are x - 1 and x on even rows, and x
+	 * and x + 1 on odd rows. Can be combined with MINESWEEPER_TORUS if
+	 * the height is even, or init returns NULL. */
+	MINESWEEPER_HEX = 1 << 5
+};
+
+/* Options that change which tiles are adjacent */
+#define MINESWEEPER_TOPOLOGY_OPTIONS (MINESWEEPER_TORUS | MINESWEEPER_HEX)
+
+#define MINESWEEPER_MIN_LABELLED_REGION_SIZE 64
+#define MINESWEEPER_MAX_ZERO_REGIONS (UINT16_MAX - 1)
+
 struct minesweeper_tile {
 	uint8_t adjacent_mine_count : 4;
 	bool has_flag : 1;
 	bool has_mine : 1;
 	bool is_opened : 1;
+	bool reserved : 1; /* Used internally while opening tiles, don't read or modify */
 };
 
 struct minesweeper_game;
+struct minesweeper_change_tracker;
+struct minesweeper_update_queue;
+struct minesweeper_checkpoint;
 typedef void (*minesweeper_callback) (struct minesweeper_game *game, struct minesweeper_tile *tile, void *user_info);
+typedef void (*minesweeper_area_callback) (struct minesweeper_game *game, unsigned min_x, unsigned min_y, unsigned max_x, unsigned max_y, void *user_info);
+
+/**
+ * A connected region of tiles without adjacent mines,
+ * see MINESWEEPER_LABEL_ZERO_REGIONS.
+ */
+struct minesweeper_zero_region {
+	unsigned min_x, min_y, max_x, max_y; /* Bounding box of the region, including its border */
+	unsigned flag_count; /* Flags in the region or on its border. The region can only be opened in bulk without flags */
+	bool is_opened;
+};
+
+/**
+ * Tiles that have been opened, but whose adjacent tiles are yet to be
+ * opened. They're queued as row-major indices in a ring buffer within
+ * the game buffer. Tiles that don't fit when the queue is full are only
+ * marked as pending, and are found again by scanning their bounding box
+ * once the queue has run empty. Queued tiles that are no longer pending
+ * are skipped.
+ */
+struct minesweeper_cascade {
+	uint32_t *queue;
+	unsigned queue_capacity;
+	unsigned queue_start, queue_length;
+	unsigned pending_count; /* Both queued and unqueued */
+	bool has_unqueued; /* Set when a pending tile didn't fit in the queue */
+	unsigned min_x, min_y, max_x, max_y; /* Bounding box of all pending tiles */
+	unsigned rescan_row; /* Where to continue scanning for unqueued tiles */
+};
 
 /**
  * Contains data for a single minesweeper game.
@@ -45,9 +126,60 @@ struct minesweeper_game {
 	unsigned flag_count;
 	struct minesweeper_tile *selected_tile; /* Pointer to the tile under the cursor */
 	struct minesweeper_tile *tiles;
+	struct minesweeper_cascade cascade; /* The rest of a cascade that was stopped by minesweeper_open_tile_with_budget() */
+	uint8_t *adjacent_flag_counts; /* One per tile, in the same order as tiles. NULL unless MINESWEEPER_TRACK_ADJACENT_FLAGS is used */
+	unsigned options;
 	enum minesweeper_game_state state;
 	minesweeper_callback tile_update_callback; /* Optional function pointer to receive tile state updates */
 	void *user_info; /* Can be used for anything, will be passed as a parameter to tile_update_callback */
+	struct minesweeper_change_tracker *change_tracker; /* Optional, see minesweeper_track_changes() */
+	struct minesweeper_checkpoint *checkpoint; /* Newest checkpoint, see minesweeper_checkpoint.h */
+	struct minesweeper_update_queue *update_queue; /* Optional, see minesweeper_queue_updates() in minesweeper_queue.h */
+	struct minesweeper_hint_cache *hint_cache; /* Optional, see minesweeper_cache_hints() in minesweeper_hint.h */
+	struct minesweeper_cursor_index *cursor_index; /* Optional, see minesweeper_index_cursor_jumps() in minesweeper_cursor.h */
+	struct minesweeper_overview *overview; /* Optional, see minesweeper_track_overview() in minesweeper_overview.h */
+	minesweeper_area_callback area_update_callback; /* Optional. If set, tiles opened in bulk are reported through this instead of tile_update_callback */
+
+	/* Only used with MINESWEEPER_LABEL_ZERO_REGIONS. Labels are stored in row-major order, and are
+	 * 0 for unlabelled tiles, a region index + 1 for tiles in or on the border of a single region,
+	 * or MINESWEEPER_MULTIPLE_REGIONS for tiles on the border of several regions. */
+	uint16_t *zero_region_labels;
+	struct minesweeper_zero_region *zero_regions;
+	uint32_t *zero_region_fill_stack; /* Used while labelling, as large as the cascade queue */
+	unsigned zero_region_count;
+	bool zero_regions_outdated; /* Set when mines are moved or tiles are closed again, the regions are then relabelled on the next cascade */
+
+	/* Bounding box of the tiles changed so far by minesweeper_apply_actions(),
+	 * while it collects them for a single area_update_callback */
+	unsigned batch_min_x, batch_min_y, batch_max_x, batch_max_y;
+	bool batch_has_changes;
+
+	/* Random number generator state for seeded games, see minesweeper_init_with_seed() */
+	uint32_t random_state;
+	bool is_seeded;
+
+	/* Zobrist hashes, kept up to date as tiles change. Equal boards of the same
+	 * size have equal hashes, no matter in which order their tiles changed. */
+	uint64_t mine_hash; /* Of which tiles have mines */
+	uint64_t visible_hash; /* Of which tiles are opened and which are flagged */
+};
+
+#define MINESWEEPER_MULTIPLE_REGIONS UINT16_MAX
+
+/**
+ * Records which tiles have changed since it was last drained, as
+ * one bit per tile in row-major order (y * width + x). Updated at
+ * the same points where tile_update_callback is called.
+ *
+ * word_bits contains one bit per word in tile_bits, so that sparse
+ * changes on a large board can be found without scanning every word.
+ *
+ * Created by minesweeper_track_changes().
+ */
+struct minesweeper_change_tracker {
+	uint32_t *tile_bits;
+	uint32_t *word_bits;
+	unsigned changed_tile_count; /* Number of bits set in tile_bits */
 };
 
 /**
@@ -62,6 +194,41 @@ struct minesweeper_game {
 struct minesweeper_game *minesweeper_init(unsigned width, unsigned height, float mine_density, uint8_t *buffer);
 size_t minesweeper_minimum_buffer_size(unsigned width, unsigned height);
 
+/**
+ * Same as minesweeper_init(), but with optional features enabled.
+ *
+ * options: Any combination of values from enum minesweeper_options
+ * buffer: Must be at least the size returned from minesweeper_buffer_size_with_options() for the same options
+ *
+ * Returns NULL if the size is too small for the topology options, see
+ * MINESWEEPER_TORUS and MINESWEEPER_HEX.
+ */
+struct minesweeper_game *minesweeper_init_with_options(unsigned width, unsigned height, float mine_density, unsigned options, uint8_t *buffer);
+size_t minesweeper_buffer_size_with_options(unsigned width, unsigned height, unsigned options);
+
+/**
+ * Same as minesweeper_init_with_options(), but mines are placed using
+ * a random number generator within the game, seeded with seed, instead
+ * of rand(). The same seed always gives the same board on every
+ * platform, and seeded games can be created on several threads at once.
+ * With MINESWEEPER_DEFERRED_GENERATION, the board also depends on the
+ * first tile opened.
+ */
+struct minesweeper_game *minesweeper_init_with_seed(unsigned width, unsigned height, float mine_density, unsigned options, uint32_t seed, uint8_t *buffer);
+
+/**
+ * Start recording changed tiles for a game. Useful for sending changes
+ * in bulk (see minesweeper_delta.h) instead of handling every callback.
+ *
+ * buffer: A memory location to store the tracker at. Must be at least the size
+ * returned from minesweeper_change_tracker_buffer_size() for the game's width and height
+ *
+ * Returns a pointer to somewhere within buffer, which is also assigned to
+ * game->change_tracker. Set game->change_tracker to NULL to stop tracking.
+ */
+struct minesweeper_change_tracker *minesweeper_track_changes(struct minesweeper_game *game, uint8_t *buffer);
+size_t minesweeper_change_tracker_buffer_size(unsigned width, unsigned height);
+
 /**
  * Set the location of the cursor. "The cursor"
  * is another name for game->selected_tile.
@@ -90,6 +257,32 @@ void minesweeper_move_cursor(struct minesweeper_game *game, enum direction direc
  */
 void minesweeper_open_tile(struct minesweeper_game *game, struct minesweeper_tile *tile);
 
+/**
+ * Opens a tile like minesweeper_open_tile(), but stops the cascade once
+ * it has opened or checked about max_tiles tiles, so that opening a huge
+ * area can be spread over several frames. It may go over by the tiles
+ * around one run of pending tiles, or a whole region with
+ * MINESWEEPER_LABEL_ZERO_REGIONS.
+ *
+ * The rest of the cascade is kept in game->cascade, and continues with
+ * minesweeper_continue_cascade(). The game stays consistent in between:
+ * state, opened_tile_count and callbacks are up to date for the tiles
+ * that have been opened so far, and the game is won as soon as the last
+ * tile is opened. Other moves can be made while a cascade is stopped.
+ * Opening tiles in any other way finishes the cascade.
+ *
+ * Returns true if the cascade is finished.
+ */
+bool minesweeper_open_tile_with_budget(struct minesweeper_game *game, struct minesweeper_tile *tile, unsigned max_tiles);
+
+/**
+ * Continues a cascade stopped by minesweeper_open_tile_with_budget(),
+ * with a budget of max_tiles more tiles.
+ *
+ * Returns true if the cascade is finished.
+ */
+bool minesweeper_continue_cascade(struct minesweeper_game *game, unsigned max_tiles);
+
 /**
  * Open souraounding tiles if tile is opened, else a flag is placed
  */
@@ -118,6 +311,8 @@ void minesweeper_get_tile_location(struct minesweeper_game *game, struct mineswe
  *
  * adjacent_tiles: A pointer to an array of 8 tile pointers. Pointers to the resulting tiles will
  * be written to this array. Some tiles may be NULL, if tile is adjacent to an edge.
+ * With MINESWEEPER_HEX, the tiles are above left, above right, left, right, below left
+ * and below right, and the last two are always NULL.
  */
 void minesweeper_get_adjacent_tiles(struct minesweeper_game *game, struct minesweeper_tile *tile, struct minesweeper_tile *adjacent_tiles[8]);
 
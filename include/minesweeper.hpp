@@ -3,9 +3,15 @@
 #include <functional>
 #include <memory>
 #include <iostream>
+#include <stdexcept>
+#include <cstddef>
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#endif
 
 extern "C" {
 	#include <minesweeper.h>
+	#include <minesweeper_checkpoint.h>
 }
 
 namespace Minesweeper {
@@ -16,6 +22,7 @@ namespace Minesweeper {
 
 	public:
 		void open();
+		bool openWithBudget(unsigned maxTiles);
 		void toggleFlag();
 		void spaceTile();
 		void toggleMine();
@@ -38,24 +45,90 @@ namespace Minesweeper {
 	class Game {
 
 	public:
-		Game(unsigned width, unsigned height, float mineDensity);
+		Game(unsigned width, unsigned height, float mineDensity, unsigned options = 0);
+
+		/**
+		 * Create a game in a caller-provided buffer, which must be at least
+		 * bufferSize(width, height, options) bytes, suitably aligned for a
+		 * pointer, and outlive the game. Throws std::length_error if it's too small.
+		 */
+		Game(unsigned width, unsigned height, float mineDensity, unsigned options, uint8_t *buffer, size_t size);
+#if __cplusplus >= 201703L
+		/**
+		 * Create a game whose buffer, and the buffers of any checkpoints,
+		 * are allocated from resource, which must outlive the game.
+		 */
+		Game(unsigned width, unsigned height, float mineDensity, unsigned options, std::pmr::memory_resource *resource);
+#endif
+
+		/**
+		 * Games can be moved, for example to keep them by value in a
+		 * std::vector. Moving is cheap, as the board itself stays in place.
+		 * A moved-from game may only be destroyed or assigned to.
+		 */
+		Game(Game &&other) noexcept;
+		Game &operator=(Game &&other) noexcept;
+		Game(const Game &) = delete;
+		Game &operator=(const Game &) = delete;
+		void swap(Game &other) noexcept;
+
+		static size_t bufferSize(unsigned width, unsigned height, unsigned options = 0);
 		unsigned width();
 		unsigned height();
 		unsigned mineCount();
 		unsigned openedTileCount();
 		unsigned flagCount();
+		uint64_t mineHash();
+		uint64_t visibleHash();
 		minesweeper_game_state state();
 		void setCursor(unsigned x, unsigned y);
 		void moveCursor(direction direction, bool should_wrap);
 		Tile selectedTile();
 		Tile tileAt(unsigned x, unsigned y);
+		void saveCheckpoint(unsigned pageCapacity = 1024);
+		bool rollback();
+		void releaseCheckpoint();
+		bool continueCascade(unsigned maxTiles);
 		std::function<void(Game&, Tile&)> tileUpdateCallback;
 
 	private:
-		std::unique_ptr<uint8_t[]> buffer;
-		minesweeper_game *internal;
+		/**
+		 * Frees a buffer the way it was allocated, or not at all
+		 * for a buffer that belongs to the caller.
+		 */
+		struct BufferDeleter {
+			void (*free)(uint8_t *buffer, size_t size, void *context);
+			void *context;
+			size_t size;
+
+			BufferDeleter(): free(nullptr), context(nullptr), size(0) {}
+
+			void operator()(uint8_t *buffer) const {
+				if (free != nullptr)
+					free(buffer, size, context);
+			}
+		};
+		typedef std::unique_ptr<uint8_t[], BufferDeleter> Buffer;
+
+		struct Checkpoint {
+			Buffer buffer;
+			minesweeper_checkpoint *internal;
+		};
+
+		Buffer allocate(size_t size);
+		void init(unsigned width, unsigned height, float mineDensity, unsigned options);
+
+		Buffer buffer;
+		minesweeper_game *internal = nullptr;
+		std::vector<Checkpoint> checkpoints; /* Released checkpoints are kept for reuse */
+		size_t checkpointDepth = 0;
+		void *resource = nullptr; /* A std::pmr::memory_resource to allocate from, if not NULL */
 	};
 
+	inline void swap(Game &a, Game &b) noexcept {
+		a.swap(b);
+	}
+
 	extern "C" void callbackHandler(minesweeper_game *game, struct minesweeper_tile *tile, void *context) {
 		Game *gameObject = (Game *)context;
 		unsigned x, y; minesweeper_get_tile_location(game, tile, &x, &y);
@@ -65,13 +138,90 @@ namespace Minesweeper {
 		}
 	}
 
-	inline Game::Game(unsigned width, unsigned height, float mineDensity) {
-		buffer = std::make_unique<uint8_t[]>(minesweeper_minimum_buffer_size(width, height));
-		internal = minesweeper_init(width, height, mineDensity, buffer.get());
+	inline Game::Buffer Game::allocate(size_t size) {
+		BufferDeleter deleter;
+		deleter.size = size;
+#if __cplusplus >= 201703L
+		if (resource != nullptr) {
+			deleter.context = resource;
+			deleter.free = [](uint8_t *buffer, size_t size, void *context) {
+				((std::pmr::memory_resource *)context)->deallocate(buffer, size, alignof(std::max_align_t));
+			};
+			return Buffer((uint8_t *)((std::pmr::memory_resource *)resource)->allocate(size, alignof(std::max_align_t)), deleter);
+		}
+#endif
+		deleter.free = [](uint8_t *buffer, size_t, void *) {
+			delete[] buffer;
+		};
+		return Buffer(new uint8_t[size](), deleter);
+	}
+
+	inline void Game::init(unsigned width, unsigned height, float mineDensity, unsigned options) {
+		internal = minesweeper_init_with_options(width, height, mineDensity, options, buffer.get());
+		if (internal == nullptr)
+			throw std::invalid_argument("Board is too small for this topology.");
 		internal->tile_update_callback = &callbackHandler;
 		internal->user_info = this;
 	}
 
+	inline Game::Game(unsigned width, unsigned height, float mineDensity, unsigned options) {
+		buffer = allocate(bufferSize(width, height, options));
+		init(width, height, mineDensity, options);
+	}
+
+	inline Game::Game(unsigned width, unsigned height, float mineDensity, unsigned options, uint8_t *buffer, size_t size) {
+		if (size < bufferSize(width, height, options))
+			throw std::length_error("Buffer is too small for this game.");
+		/* The default deleter leaves the buffer to the caller */
+		this->buffer = Buffer(buffer, BufferDeleter());
+		init(width, height, mineDensity, options);
+	}
+
+#if __cplusplus >= 201703L
+	inline Game::Game(unsigned width, unsigned height, float mineDensity, unsigned options, std::pmr::memory_resource *resource): resource(resource) {
+		buffer = allocate(bufferSize(width, height, options));
+		init(width, height, mineDensity, options);
+	}
+#endif
+
+	inline Game::Game(Game &&other) noexcept:
+		tileUpdateCallback(std::move(other.tileUpdateCallback)),
+		buffer(std::move(other.buffer)),
+		internal(other.internal),
+		checkpoints(std::move(other.checkpoints)),
+		checkpointDepth(other.checkpointDepth),
+		resource(other.resource) {
+		/* The board stays where it is, but callbacks must now reach this object */
+		if (internal != nullptr)
+			internal->user_info = this;
+		other.internal = nullptr;
+		other.checkpointDepth = 0;
+	}
+
+	inline Game &Game::operator=(Game &&other) noexcept {
+		Game moved(std::move(other));
+		swap(moved);
+		return *this;
+	}
+
+	inline void Game::swap(Game &other) noexcept {
+		using std::swap;
+		swap(tileUpdateCallback, other.tileUpdateCallback);
+		swap(buffer, other.buffer);
+		swap(internal, other.internal);
+		swap(checkpoints, other.checkpoints);
+		swap(checkpointDepth, other.checkpointDepth);
+		swap(resource, other.resource);
+		if (internal != nullptr)
+			internal->user_info = this;
+		if (other.internal != nullptr)
+			other.internal->user_info = &other;
+	}
+
+	inline size_t Game::bufferSize(unsigned width, unsigned height, unsigned options) {
+		return minesweeper_buffer_size_with_options(width, height, options);
+	}
+
 	inline unsigned Game::width() {
 		return internal->width;
 	}
@@ -92,6 +242,14 @@ namespace Minesweeper {
 		return internal->flag_count;
 	}
 
+	inline uint64_t Game::mineHash() {
+		return internal->mine_hash;
+	}
+
+	inline uint64_t Game::visibleHash() {
+		return internal->visible_hash;
+	}
+
 	inline minesweeper_game_state Game::state() {
 		return internal->state;
 	}
@@ -120,10 +278,48 @@ namespace Minesweeper {
 		return Tile(tilePtr, this->internal);
 	}
 
+	/**
+	 * Save the current state, to roll back to with rollback(). See minesweeper_checkpoint.h.
+	 * pageCapacity: The number of pages of MINESWEEPER_CHECKPOINT_PAGE_SIZE tiles that may be
+	 * modified before the checkpoint overflows and can no longer be rolled back
+	 */
+	inline void Game::saveCheckpoint(unsigned pageCapacity) {
+		if (checkpointDepth == checkpoints.size())
+			checkpoints.push_back(Checkpoint());
+		Checkpoint &checkpoint = checkpoints[checkpointDepth];
+		if (!checkpoint.buffer || checkpoint.internal->page_capacity < pageCapacity) {
+			checkpoint.buffer = allocate(minesweeper_checkpoint_buffer_size(internal, pageCapacity));
+			checkpoint.internal = minesweeper_init_checkpoint(internal, pageCapacity, checkpoint.buffer.get());
+		}
+		minesweeper_save_checkpoint(internal, checkpoint.internal);
+		checkpointDepth++;
+	}
+
+	inline bool Game::rollback() {
+		if (checkpointDepth == 0)
+			throw std::logic_error("No checkpoint to roll back to. Call saveCheckpoint() first.");
+		return minesweeper_rollback(internal);
+	}
+
+	inline void Game::releaseCheckpoint() {
+		if (checkpointDepth == 0)
+			throw std::logic_error("No checkpoint to release.");
+		minesweeper_release_checkpoint(internal);
+		checkpointDepth--;
+	}
+
+	inline bool Game::continueCascade(unsigned maxTiles) {
+		return minesweeper_continue_cascade(internal, maxTiles);
+	}
+
 	inline void Tile::open() {
 		minesweeper_open_tile(game, internal);
 	}
 
+	inline bool Tile::openWithBudget(unsigned maxTiles) {
+		return minesweeper_open_tile_with_budget(game, internal, maxTiles);
+	}
+
 	inline void Tile::toggleFlag() {
 		minesweeper_toggle_flag(game, internal);
 	}
@@ -0,0 +1,54 @@
+#ifndef MINESWEEPER_BATCH_H
+#define MINESWEEPER_BATCH_H
+
+#include <minesweeper.h>
+
+/**
+ * Applying many player actions at once, such as all inputs a
+ * server received during one tick.
+ */
+
+enum minesweeper_action_type {
+	MINESWEEPER_ACTION_OPEN, /* Same as minesweeper_open_tile() */
+	MINESWEEPER_ACTION_TOGGLE_FLAG, /* Same as minesweeper_toggle_flag() */
+	MINESWEEPER_ACTION_SPACE /* Same as minesweeper_space_tile() */
+};
+
+struct minesweeper_action {
+	enum minesweeper_action_type type;
+	unsigned x, y;
+};
+
+enum minesweeper_action_result {
+	MINESWEEPER_ACTION_APPLIED, /* The action changed the game */
+	MINESWEEPER_ACTION_NO_CHANGE, /* The action was valid, but didn't change anything, such as opening an opened tile */
+	MINESWEEPER_ACTION_OUT_OF_BOUNDS,
+	MINESWEEPER_ACTION_INVALID_TYPE,
+	MINESWEEPER_ACTION_SKIPPED /* Not applied, because the game was over (won or lost) by then */
+};
+
+/**
+ * Apply count actions in order. Invalid actions are skipped, and once
+ * the game is won or lost, the remaining actions are skipped too. With
+ * results, all actions are validated in one pass before any of them is
+ * applied. Batches aren't atomic though: an invalid action is only
+ * skipped, and the valid actions around it are still applied.
+ *
+ * If game->area_update_callback is set, it's called once after the
+ * batch, with the bounding box of all tiles the batch changed, instead
+ * of sending callbacks for every tile. Otherwise, tile_update_callback
+ * is called for every changed tile as usual. To get the changed tiles
+ * themselves as one change set, for example to encode with
+ * minesweeper_delta_encode(), attach a change tracker with
+ * minesweeper_track_changes(). An attached update queue still receives
+ * every change.
+ *
+ * results: If not NULL, the result of every action is written here.
+ * Without results, each action is validated right before it's applied,
+ * and nothing is done for the actions after the game ended
+ *
+ * Returns the number of actions that changed the game.
+ */
+size_t minesweeper_apply_actions(struct minesweeper_game *game, const struct minesweeper_action *actions, size_t count, enum minesweeper_action_result *results);
+
+#endif
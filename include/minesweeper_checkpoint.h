@@ -0,0 +1,79 @@
+#ifndef MINESWEEPER_CHECKPOINT_H
+#define MINESWEEPER_CHECKPOINT_H
+
+#include <minesweeper.h>
+
+/**
+ * Checkpoints let a game be rolled back to an earlier state, for trying
+ * out moves without copying the whole game. Tiles are divided into pages
+ * of MINESWEEPER_CHECKPOINT_PAGE_SIZE tiles in storage order. Saving a
+ * checkpoint costs nothing up front. Instead, a page is copied into the
+ * newest checkpoint the first time it's modified after the checkpoint was
+ * saved, so both rolling back and releasing a checkpoint only cost as
+ * much as the number of pages modified.
+ *
+ * Checkpoints can be nested, and only the newest one can be rolled back
+ * or released. Callbacks are sent for tiles that change when rolling back.
+ */
+
+#define MINESWEEPER_CHECKPOINT_PAGE_SIZE 64
+
+struct minesweeper_checkpoint {
+	struct minesweeper_checkpoint *previous; /* The checkpoint that was newest before this one was saved */
+	uint32_t *saved_page_bits; /* One bit per page, set for the pages in saved_pages */
+	uint32_t *saved_pages; /* Indices of saved pages */
+	uint8_t *page_storage; /* Contents of saved pages, in the same order as saved_pages */
+	unsigned page_capacity;
+	unsigned saved_page_count;
+	bool overflowed; /* Set when more than page_capacity pages are modified, the checkpoint can then no longer be rolled back */
+
+	/* Game counters when the checkpoint was saved */
+	enum minesweeper_game_state state;
+	unsigned mine_count;
+	unsigned flag_count;
+	unsigned opened_tile_count;
+	uint32_t random_state;
+	uint64_t mine_hash;
+	uint64_t visible_hash;
+	struct minesweeper_cascade cascade;
+};
+
+/**
+ * Prepare a buffer for a checkpoint, which can then be saved any number
+ * of times with minesweeper_save_checkpoint(). Takes time proportional to
+ * the board size, so create checkpoints once and reuse them.
+ *
+ * page_capacity: The number of pages the checkpoint can hold. Modifying
+ * more pages than that after saving the checkpoint makes it overflow
+ * buffer: A memory location to store the checkpoint in. Must be at least the size returned
+ * from minesweeper_checkpoint_buffer_size() for the same game and page_capacity
+ *
+ * Returns a pointer to somewhere within buffer.
+ */
+struct minesweeper_checkpoint *minesweeper_init_checkpoint(struct minesweeper_game *game, unsigned page_capacity, uint8_t *buffer);
+size_t minesweeper_checkpoint_buffer_size(struct minesweeper_game *game, unsigned page_capacity);
+
+/**
+ * Save the current state of the game in a checkpoint, which becomes
+ * the game's newest checkpoint. The checkpoint must not be in use already.
+ */
+void minesweeper_save_checkpoint(struct minesweeper_game *game, struct minesweeper_checkpoint *checkpoint);
+
+/**
+ * Restore the game to the state of its newest checkpoint. The checkpoint
+ * stays in use, so the game can be rolled back to it again later.
+ *
+ * Returns false without changing the game if the checkpoint overflowed,
+ * or if no checkpoint is saved.
+ */
+bool minesweeper_rollback(struct minesweeper_game *game);
+
+/**
+ * Stop using the newest checkpoint while keeping the current state of the
+ * game. The previous checkpoint, if any, becomes the newest one again.
+ * The released checkpoint can then be saved again. Does nothing if no
+ * checkpoint is saved.
+ */
+void minesweeper_release_checkpoint(struct minesweeper_game *game);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef MINESWEEPER_CURSOR_H
+#define MINESWEEPER_CURSOR_H
+
+#include <minesweeper.h>
+
+/**
+ * Jumping the cursor to the next tile of a kind, for keyboard and
+ * screen reader controls.
+ *
+ * Without a cursor index, every jump scans tiles one at a time. With one
+ * attached (see minesweeper_index_cursor_jumps()), a jump only reads a
+ * few words of a bitmap, even on huge boards where matching tiles are
+ * far apart.
+ */
+
+enum minesweeper_tile_kind {
+	MINESWEEPER_UNOPENED_TILE,
+	MINESWEEPER_UNFLAGGED_TILE, /* Unopened, without a flag */
+	MINESWEEPER_FRONTIER_TILE, /* Unopened, next to an opened tile */
+	MINESWEEPER_TILE_KIND_COUNT
+};
+
+struct minesweeper_tile_bitmap {
+	uint32_t *tile_bits; /* One bit per tile, row by row. Each row starts on a new word */
+	uint32_t *word_bits; /* One bit per word in tile_bits, set when the word isn't zero */
+};
+
+struct minesweeper_cursor_index {
+	struct minesweeper_tile_bitmap bitmaps[MINESWEEPER_TILE_KIND_COUNT];
+	struct minesweeper_tile_bitmap column_bitmaps[MINESWEEPER_TILE_KIND_COUNT]; /* The same bits column by column, for jumps up and down */
+	unsigned row_words; /* Words per row in bitmaps */
+	unsigned column_words; /* Words per column in column_bitmaps */
+};
+
+/**
+ * Attach a cursor index to a game. It's built from the current tiles,
+ * and then kept up to date at the same points where tile_update_callback
+ * is called.
+ *
+ * buffer: A memory location to store the index in. Must be at least the size
+ * returned from minesweeper_cursor_index_buffer_size() for the same board size
+ *
+ * Returns a pointer to somewhere within buffer, which is also assigned to
+ * game->cursor_index. Set game->cursor_index to NULL to detach it.
+ */
+struct minesweeper_cursor_index *minesweeper_index_cursor_jumps(struct minesweeper_game *game, uint8_t *buffer);
+size_t minesweeper_cursor_index_buffer_size(unsigned width, unsigned height);
+
+/**
+ * Move the cursor to the next tile of a kind in reading order (left to
+ * right, then top to bottom), or to the previous one if backwards is set.
+ * Without a selected tile, the search starts from the first tile, or the
+ * last one when going backwards.
+ *
+ * If should_wrap is true, the search continues from the other end of
+ * the board, and may end up on the selected tile itself.
+ *
+ * Returns false without moving the cursor if there is no such tile.
+ */
+bool minesweeper_jump_cursor(struct minesweeper_game *game, enum minesweeper_tile_kind kind, bool backwards, bool should_wrap);
+
+/**
+ * Move the cursor to the nearest tile of a kind in a direction, within
+ * the same row or column. Requires a selected tile.
+ *
+ * Returns false without moving the cursor if there is no such tile.
+ */
+bool minesweeper_jump_cursor_in_direction(struct minesweeper_game *game, enum minesweeper_tile_kind kind, enum direction direction);
+
+#endif
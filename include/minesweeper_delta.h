@@ -0,0 +1,70 @@
+#ifndef MINESWEEPER_DELTA_H
+#define MINESWEEPER_DELTA_H
+
+#include <minesweeper.h>
+
+/**
+ * Compact binary encoding of board changes, for keeping remote copies
+ * of a game in sync without sending every tile update separately.
+ *
+ * A delta message has the following layout. All fixed size integers are
+ * little endian, and varints are LEB128 (7 bits per byte, low bits first):
+ *
+ *   u32 sequence
+ *   u8  state
+ *   u32 mine_count, opened_tile_count, flag_count
+ *   u32 run_count
+ *   run_count times:
+ *     varint gap     Number of unchanged tiles since the end of the previous run
+ *     varint length  Number of changed tiles in this run
+ *     (length + 1) / 2 bytes of tile values, two per byte, low nibble first
+ *
+ * Tiles are numbered in row-major order (y * width + x). A tile value is
+ * what a player can see: 0-8 for an opened tile with that adjacent mine
+ * count, or one of the MINESWEEPER_DELTA_* values below.
+ */
+#define MINESWEEPER_DELTA_OPENED_MINE 9
+#define MINESWEEPER_DELTA_FLAGGED 10
+#define MINESWEEPER_DELTA_HIDDEN 11
+
+#define MINESWEEPER_DELTA_HEADER_SIZE 21
+
+/**
+ * The largest message minesweeper_delta_encode() can produce for the
+ * changes currently recorded in game->change_tracker.
+ */
+size_t minesweeper_delta_max_size(struct minesweeper_game *game);
+
+/**
+ * Encode all tiles recorded in game->change_tracker, and clear the tracker.
+ * The game must be tracking changes (see minesweeper_track_changes()).
+ *
+ * sequence: Written to the message, so that receivers can detect lost or reordered messages
+ * out: A memory location to write the message to. Should be at least minesweeper_delta_max_size() bytes
+ *
+ * Returns the size of the message, or 0 if out_size is too small. The
+ * tracker is left untouched if the message doesn't fit.
+ */
+size_t minesweeper_delta_encode(struct minesweeper_game *game, uint32_t sequence, uint8_t *out, size_t out_size);
+
+/**
+ * Apply a message from minesweeper_delta_encode() to a mirror of the
+ * game, created by minesweeper_init() or minesweeper_init_with_options()
+ * with the same width and height and a mine_density of 0, so that tiles
+ * no message has mentioned yet don't have mines or adjacent mine counts.
+ * Hidden information (mines under unopened tiles, and adjacent mine counts
+ * of unopened tiles) is never part of a message, so it's cleared in the mirror.
+ * No callbacks are sent to the mirror, but its hashes, adjacent flag
+ * counts and optional indices are kept up to date. The mirror can't use
+ * MINESWEEPER_LABEL_ZERO_REGIONS, since it doesn't know where the mines are.
+ *
+ * sequence: If not NULL, the sequence number of the message is written here
+ *
+ * Returns false if the message is malformed (including an unknown game
+ * state), doesn't fit the mirror, or the mirror uses
+ * MINESWEEPER_LABEL_ZERO_REGIONS. The mirror may have been partially
+ * updated in that case.
+ */
+bool minesweeper_delta_decode(struct minesweeper_game *mirror, const uint8_t *data, size_t size, uint32_t *sequence);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MINESWEEPER_HINT_H
+#define MINESWEEPER_HINT_H
+
+#include <minesweeper.h>
+
+/**
+ * Hints for the player, deduced only from what the player can see: the
+ * opened tiles and the total number of mines. Flags are ignored, since
+ * they may be wrong.
+ *
+ * Deductions are kept in a hint cache attached to the game, which is
+ * updated at the same points where tile_update_callback is called. Only
+ * the opened tiles around a changed tile are checked again, so asking
+ * for a hint after a move costs about as much as the move itself, and
+ * asking again without any move in between returns the cached hint.
+ *
+ * Each opened tile is checked on its own: its unknown neighbours are
+ * safe when its mines are all known, and mines when they're exactly as
+ * many as its remaining mines. Tiles are never compared with each other
+ * (such as one tile's neighbours being a subset of another's), so some
+ * safe tiles an experienced player would find are suggested as guesses.
+ * The mine probability of a guess is the highest share of remaining
+ * mines among the opened tiles next to it, or the share of mines that
+ * aren't known yet for a tile with no opened neighbours.
+ */
+
+struct minesweeper_hint {
+	unsigned x, y;
+	bool is_safe; /* True if the tile can't have a mine. Otherwise the tile is the least likely to have one */
+	float mine_probability; /* An estimate, exactly 0 for safe tiles */
+};
+
+struct minesweeper_hint_cache {
+	uint8_t *tile_states; /* One per tile in row-major order, see minesweeper_hint.c */
+	uint32_t *pending; /* Row-major indices of opened tiles to check again */
+	uint32_t *safe_tiles; /* Row-major indices of unopened tiles deduced to be safe */
+	uint32_t *outdated_guesses; /* Row-major indices of tiles whose mine probability must be computed again */
+	float *guess_probabilities; /* One per tile in row-major order, negative for tiles without opened neighbours */
+	size_t pending_count;
+	size_t safe_tile_count;
+	size_t outdated_guess_count;
+	unsigned known_mine_count;
+	bool is_outdated; /* Set when tiles changed in a way that can undo deductions, such as moving mines */
+	bool has_hint; /* Set when hint is still valid */
+	struct minesweeper_hint hint;
+};
+
+/**
+ * Attach a hint cache to a game.
+ *
+ * buffer: A memory location to store the cache in. Must be at least the size
+ * returned from minesweeper_hint_cache_buffer_size() for the same board size
+ *
+ * Returns a pointer to somewhere within buffer, which is also assigned to
+ * game->hint_cache. Set game->hint_cache to NULL to detach it.
+ */
+struct minesweeper_hint_cache *minesweeper_cache_hints(struct minesweeper_game *game, uint8_t *buffer);
+size_t minesweeper_hint_cache_buffer_size(unsigned width, unsigned height);
+
+/**
+ * Find a tile to open, preferring one that is certainly safe. Tiles with
+ * flags are never suggested. Requires a hint cache, see minesweeper_cache_hints().
+ *
+ * Returns false if there is no tile to suggest, such as when the game is over.
+ */
+bool minesweeper_get_hint(struct minesweeper_game *game, struct minesweeper_hint *hint);
+
+#endif
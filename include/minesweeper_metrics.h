@@ -0,0 +1,43 @@
+#ifndef MINESWEEPER_METRICS_H
+#define MINESWEEPER_METRICS_H
+
+#include <minesweeper.h>
+
+/**
+ * Difficulty metrics of a board, for ranking scores and matching players.
+ * These only depend on where the mines are, not on the state of the game.
+ */
+
+struct minesweeper_metrics {
+	unsigned bbbv; /* 3BV, the minimum number of clicks needed to open every tile without a mine */
+	unsigned openings; /* Connected regions of tiles without mines or adjacent mines, each opened with a single click */
+	unsigned isolated_numbers; /* Tiles with adjacent mines that aren't next to an opening, so each takes a click of its own */
+};
+
+/**
+ * Compute the metrics of a board in a single pass over its rows. Openings
+ * are counted with a union-find forest that only spans the previous and
+ * the current row. With MINESWEEPER_DEFERRED_GENERATION, the mines must
+ * have been placed, so the first tile must have been opened.
+ *
+ * buffer: Temporary memory. Must be at least the size returned from
+ * minesweeper_metrics_buffer_size() for the same width
+ *
+ * Returns false for boards with MINESWEEPER_TOPOLOGY_OPTIONS, whose
+ * openings can't be counted a row at a time. metrics is then not written.
+ */
+bool minesweeper_compute_metrics(const struct minesweeper_game *game, struct minesweeper_metrics *metrics, uint8_t *buffer);
+size_t minesweeper_metrics_buffer_size(unsigned width);
+
+/**
+ * Compute the metrics of count games with minesweeper_compute_metrics(),
+ * split across thread_count threads (including the calling thread),
+ * writing the metrics of games[i] to metrics[i]. Like
+ * minesweeper_parallel.h, requires POSIX threads and uses malloc().
+ *
+ * Returns false if memory couldn't be allocated, or if any of the games
+ * has MINESWEEPER_TOPOLOGY_OPTIONS. Metrics are then not written.
+ */
+bool minesweeper_compute_metrics_parallel(struct minesweeper_game *const *games, size_t count, struct minesweeper_metrics *metrics, unsigned thread_count);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MINESWEEPER_OVERVIEW_H
+#define MINESWEEPER_OVERVIEW_H
+
+#include <minesweeper.h>
+
+/**
+ * Downsampled views of the board, for drawing huge boards zoomed out.
+ *
+ * An overview is a pyramid of grids of tile counts. Each cell of level 0
+ * covers a block of MINESWEEPER_OVERVIEW_BLOCK_SIZE x MINESWEEPER_OVERVIEW_BLOCK_SIZE
+ * tiles, and each cell of a level above covers 2x2 cells of the level
+ * below, up to a single cell for the whole board. Cells on the right and
+ * bottom edges may cover fewer tiles.
+ *
+ * Changed tiles only mark their block as outdated. Outdated blocks are
+ * counted again when a level is read, and their changes are added to the
+ * cells above them, so reading a level costs about as much as the tiles
+ * that changed, plus nothing at all for tiles that didn't.
+ */
+
+#define MINESWEEPER_OVERVIEW_BLOCK_SHIFT 3
+#define MINESWEEPER_OVERVIEW_BLOCK_SIZE (1 << MINESWEEPER_OVERVIEW_BLOCK_SHIFT)
+#define MINESWEEPER_MAX_OVERVIEW_LEVELS 30
+
+struct minesweeper_tile_counts {
+	uint32_t opened;
+	uint32_t flagged;
+	uint32_t revealed_mines; /* Opened tiles with mines */
+};
+
+struct minesweeper_overview {
+	struct minesweeper_tile_counts *levels[MINESWEEPER_MAX_OVERVIEW_LEVELS]; /* Row-major grids of cells */
+	unsigned level_widths[MINESWEEPER_MAX_OVERVIEW_LEVELS];
+	unsigned level_heights[MINESWEEPER_MAX_OVERVIEW_LEVELS];
+	unsigned level_count;
+	uint32_t *outdated_bits; /* One bit per cell of level 0, set when it's in outdated_blocks */
+	uint32_t *outdated_blocks; /* Row-major indices of level 0 cells to count again */
+	size_t outdated_block_count;
+};
+
+/**
+ * Attach an overview to a game. It's built from the current tiles, and
+ * then kept up to date at the same points where tile_update_callback is
+ * called.
+ *
+ * buffer: A memory location to store the overview in. Must be at least the size
+ * returned from minesweeper_overview_buffer_size() for the same board size
+ *
+ * Returns a pointer to somewhere within buffer, which is also assigned to
+ * game->overview. Set game->overview to NULL to detach it.
+ */
+struct minesweeper_overview *minesweeper_track_overview(struct minesweeper_game *game, uint8_t *buffer);
+size_t minesweeper_overview_buffer_size(unsigned width, unsigned height);
+
+/**
+ * Get the grid of cells of a level, with its size in width and height.
+ * Each cell covers (MINESWEEPER_OVERVIEW_BLOCK_SIZE << level) tiles in
+ * each direction. The grid stays valid until tiles change again.
+ *
+ * Returns NULL if there is no such level.
+ */
+const struct minesweeper_tile_counts *minesweeper_get_overview(struct minesweeper_game *game, unsigned level, unsigned *width, unsigned *height);
+
+/**
+ * Find the most detailed level whose grid fits within max_width x max_height
+ * cells, such as the pixels of a minimap. Returns the top level, with a
+ * single cell, if none of the others fit.
+ */
+unsigned minesweeper_overview_level_for_size(const struct minesweeper_game *game, unsigned max_width, unsigned max_height);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef MINESWEEPER_PARALLEL_H
+#define MINESWEEPER_PARALLEL_H
+
+#include <minesweeper.h>
+
+/**
+ * A multi-threaded cascade, for very large boards. Requires POSIX
+ * threads, and unlike the rest of the library, allocates memory with
+ * malloc(). Replays and metrics can be processed in batches on several
+ * threads too, see minesweeper_replay.h and minesweeper_metrics.h.
+ */
+
+/**
+ * Same as minesweeper_open_tile(), but any resulting cascade is split
+ * across thread_count threads (including the calling thread), each
+ * handling a horizontal strip of the board. The opened tiles, counters
+ * and state end up exactly the same as with minesweeper_open_tile().
+ *
+ * Labelling, marking the cascaded region and opening its tiles all run
+ * on every thread, each on its own strip. Only joining the strips where
+ * they meet is done on the calling thread, which costs about one row per
+ * thread. The whole board is scanned three times though, regardless of
+ * the size of the cascade, which on a single thread takes about as long
+ * as a serial cascade that opens the whole board. Use this only when:
+ *
+ * - thread_count is at most the number of CPU cores. Extra threads only
+ *   add overhead, so on a single core this is slower than a serial cascade.
+ * - The cascade is expected to open a large part of a board with
+ *   millions of tiles, such as the first tile on a board with few mines.
+ *
+ * `make run-benchmarks` prints the speedup over a serial cascade next to
+ * the number of cores. Uses 5 bytes of temporary memory per tile.
+ *
+ * The change tracker is updated by the threads as they open tiles. Tile
+ * update callbacks are sent from the calling thread, after all threads
+ * have finished, in row-major order. Finding the opened tiles for them
+ * is a single-threaded pass over the bounding box of the opened area,
+ * which limits the speedup when callbacks, an update queue or any of the
+ * optional indices are used.
+ *
+ * Falls back to minesweeper_open_tile() if thread_count is 1 or less, or
+ * if memory or threads can't be allocated.
+ */
+void minesweeper_open_tile_parallel(struct minesweeper_game *game, struct minesweeper_tile *tile, unsigned thread_count);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef MINESWEEPER_QUEUE_H
+#define MINESWEEPER_QUEUE_H
+
+#include <minesweeper.h>
+
+/**
+ * A wait-free single-producer, single-consumer queue of tile updates,
+ * for observing a game from another thread, such as a render or network
+ * thread. The game thread pushes a record for every changed tile while
+ * the consumer pops them, without either of them ever blocking.
+ *
+ * When the queue is full, the game thread doesn't wait. Instead, changed
+ * tiles are coalesced into a dirty region, which is pushed as a single
+ * record once there is room again. Unlike single tiles, a dirty region
+ * carries no tile states, so the consumer has to read its tiles from the
+ * game itself. That isn't synchronized by the queue: the consumer must
+ * only do so while the game thread is known not to be modifying the
+ * game, such as between frames, or make sure the queue is large enough
+ * to never fill up.
+ *
+ * Requires GCC or C11 atomics. On single-threaded platforms without
+ * either, define MINESWEEPER_SINGLE_THREADED_QUEUE when building the
+ * library, and only use the queue from the game thread.
+ */
+
+struct minesweeper_update {
+	uint32_t index; /* Row-major index (y * width + x) of the changed tile, or of the top left corner of a dirty region */
+	uint32_t last_index; /* Row-major index of the bottom right corner of a dirty region */
+	struct minesweeper_tile tile; /* For a single tile, its state right after the change */
+	bool is_region; /* A dirty region, whose tiles must be read from the game, see above */
+};
+
+#define MINESWEEPER_CACHE_LINE_SIZE 64
+
+struct minesweeper_update_queue {
+	struct minesweeper_update *records;
+	uint32_t capacity; /* A power of two */
+	unsigned width;
+
+	/* Written only by the game thread. Kept on its own cache
+	 * line so the two threads don't slow each other down. */
+	uint8_t producer_padding[MINESWEEPER_CACHE_LINE_SIZE];
+	uint32_t tail;
+	bool has_dirty_region;
+	unsigned dirty_min_x, dirty_min_y, dirty_max_x, dirty_max_y;
+
+	/* Written only by the consumer thread, with the records after it
+	 * in the buffer kept off its cache line too */
+	uint8_t consumer_padding[MINESWEEPER_CACHE_LINE_SIZE];
+	uint32_t head;
+	uint8_t records_padding[MINESWEEPER_CACHE_LINE_SIZE - sizeof(uint32_t)];
+};
+
+/**
+ * Attach an update queue to a game. Updates are pushed from then on,
+ * in addition to any callbacks.
+ *
+ * capacity: The number of records the queue can hold. Must be a power of two, or
+ * the queue isn't attached and NULL is returned
+ * buffer: A memory location to store the queue in. Must be at least the size
+ * returned from minesweeper_update_queue_buffer_size() for the same capacity
+ *
+ * Returns a pointer to somewhere within buffer, which is also assigned to
+ * game->update_queue. Set game->update_queue to NULL to detach it.
+ */
+struct minesweeper_update_queue *minesweeper_queue_updates(struct minesweeper_game *game, uint32_t capacity, uint8_t *buffer);
+size_t minesweeper_update_queue_buffer_size(uint32_t capacity);
+
+/**
+ * Push the pending dirty region, if any. This happens automatically with
+ * the next update, but the game thread should also call this regularly,
+ * such as once per frame, so that the region isn't held back while the
+ * game is idle.
+ *
+ * Returns false if the queue is still full.
+ */
+bool minesweeper_update_queue_flush(struct minesweeper_update_queue *queue);
+
+/**
+ * Pop up to max_count records into out, in the order they were pushed.
+ * Must only be called from a single consumer thread.
+ *
+ * Returns the number of records popped.
+ */
+size_t minesweeper_update_queue_pop(struct minesweeper_update_queue *queue, struct minesweeper_update *out, size_t max_count);
+
+#endif
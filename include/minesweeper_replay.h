@@ -0,0 +1,71 @@
+#ifndef MINESWEEPER_REPLAY_H
+#define MINESWEEPER_REPLAY_H
+
+#include <minesweeper.h>
+#include <minesweeper_batch.h>
+
+/**
+ * Verifying that a submitted game really played out the way its player
+ * claims, by replaying its actions on the same seeded board.
+ */
+
+struct minesweeper_replay {
+	/* The board, as created by minesweeper_init_with_seed() */
+	unsigned width, height;
+	float mine_density;
+	unsigned options;
+	uint32_t seed;
+
+	const struct minesweeper_action *actions;
+	const uint32_t *timestamps; /* Optional. The time of every action in milliseconds */
+	size_t action_count;
+
+	/* What the player claims */
+	enum minesweeper_game_state claimed_state;
+	uint32_t claimed_time; /* Milliseconds from the first to the last action. Only checked with timestamps */
+};
+
+enum minesweeper_replay_verdict {
+	MINESWEEPER_REPLAY_VALID,
+	MINESWEEPER_REPLAY_INVALID_ACTION, /* An action was out of bounds, or of an unknown type */
+	MINESWEEPER_REPLAY_ACTION_AFTER_END, /* An action came after the game was won or lost */
+	MINESWEEPER_REPLAY_TIME_WENT_BACKWARDS, /* A timestamp was earlier than the previous one */
+	MINESWEEPER_REPLAY_WRONG_TIME, /* The timestamps don't add up to claimed_time */
+	MINESWEEPER_REPLAY_WRONG_STATE, /* The game didn't end up in claimed_state */
+	MINESWEEPER_REPLAY_INVALID_BOARD, /* The board can't be created, such as a torus smaller than 3x3, or a mine density outside 0 to 1 */
+	MINESWEEPER_REPLAY_OPENED_FLAGGED_TILE, /* An action opened a flagged tile */
+	MINESWEEPER_REPLAY_TILE_ALREADY_OPENED /* An action flagged an opened tile, or opened one that can't quick-open its adjacent tiles */
+};
+
+/**
+ * Replay a game without sending any callbacks, stopping at the first
+ * impossible action. Actions that the game would ignore, such as opening
+ * a flagged tile, are impossible too. Opening an opened tile is only
+ * possible when it quick-opens the adjacent tiles, since its adjacent
+ * mines are all flagged. The whole replay, including its board, may come
+ * from an untrusted source.
+ *
+ * buffer: Used for the game. Must be at least the size returned from
+ * minesweeper_replay_buffer_size() for the same replay
+ */
+enum minesweeper_replay_verdict minesweeper_verify_replay(const struct minesweeper_replay *replay, uint8_t *buffer);
+
+/**
+ * Returns the size of the game buffer for verifying a replay, or 0 if
+ * its board is too large to be created, or has a mine density outside
+ * 0 to 1. The replay is then rejected without using the buffer.
+ */
+size_t minesweeper_replay_buffer_size(const struct minesweeper_replay *replay);
+
+/**
+ * Verify count replays with minesweeper_verify_replay(), split across
+ * thread_count threads (including the calling thread), writing the
+ * verdict for every replay to verdicts. Each thread
+ * allocates a single game buffer, large enough for any of the replays.
+ * Like minesweeper_parallel.h, requires POSIX threads and uses malloc().
+ *
+ * Returns false if memory couldn't be allocated, verdicts are then not written.
+ */
+bool minesweeper_verify_replays(const struct minesweeper_replay *replays, size_t count, enum minesweeper_replay_verdict *verdicts, unsigned thread_count);
+
+#endif
@@ -1,15 +1,99 @@
 #include <minesweeper.h>
 #include <stdlib.h>
 #include <string.h>
+#include "minesweeper_internal.h"
 
 void generate_mines(struct minesweeper_game *game, float density);
 
 struct minesweeper_game *minesweeper_init(unsigned width, unsigned height, float mine_density, uint8_t *buffer) {
+	return minesweeper_init_with_options(width, height, mine_density, 0, buffer);
+}
+
+static inline size_t align_size(size_t size, size_t alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * A cascade spreads out from where it starts, so the tiles pending at
+ * once are usually those along its edge, which fit in a queue this size.
+ */
+static inline unsigned cascade_queue_capacity(unsigned width, unsigned height) {
+	return 2 * (width + height);
+}
+
+/**
+ * Returns the size of a game buffer with the given options. If game is
+ * not NULL, it's also pointed at the storage for its optional features,
+ * which follows the tiles in the buffer.
+ */
+static size_t layout_game_buffer(struct minesweeper_game *game, unsigned width, unsigned height, unsigned options) {
+	uint8_t *buffer = (uint8_t *)game;
+	size_t tile_count = (size_t)width * height;
+	size_t size = sizeof(struct minesweeper_game) + sizeof(struct minesweeper_tile) * tile_count;
+
+	if (options & MINESWEEPER_TRACK_ADJACENT_FLAGS) {
+		if (game)
+			game->adjacent_flag_counts = buffer + size;
+		size += tile_count;
+	}
+	if ((options & MINESWEEPER_LABEL_ZERO_REGIONS) && !(options & MINESWEEPER_TOPOLOGY_OPTIONS)) {
+		size = align_size(size, sizeof(uint16_t));
+		if (game)
+			game->zero_region_labels = (uint16_t *)(buffer + size);
+		size += sizeof(uint16_t) * tile_count;
+		size = align_size(size, sizeof(unsigned));
+		if (game)
+			game->zero_regions = (struct minesweeper_zero_region *)(buffer + size);
+		size += sizeof(struct minesweeper_zero_region) * zero_region_capacity(width, height);
+		size = align_size(size, sizeof(uint32_t));
+		if (game)
+			game->zero_region_fill_stack = (uint32_t *)(buffer + size);
+		size += sizeof(uint32_t) * cascade_queue_capacity(width, height);
+	}
+	size = align_size(size, sizeof(uint32_t));
+	if (game) {
+		game->cascade.queue = (uint32_t *)(buffer + size);
+		game->cascade.queue_capacity = cascade_queue_capacity(width, height);
+	}
+	size += sizeof(uint32_t) * cascade_queue_capacity(width, height);
+	return size;
+}
+
+/**
+ * Whether adjacent tiles are all distinct with the given topology. A
+ * smaller torus would wrap onto the same tiles from both sides, and a
+ * hex torus with an odd height would wrap an odd row onto another one.
+ */
+static bool is_valid_size(unsigned width, unsigned height, unsigned options) {
+	if (!(options & MINESWEEPER_TORUS))
+		return true;
+	if (width < 3 || height < 3)
+		return false;
+	return !(options & MINESWEEPER_HEX) || height % 2 == 0;
+}
+
+static struct minesweeper_game *init_game(unsigned width, unsigned height, float mine_density, unsigned options, bool is_seeded, uint32_t seed, uint8_t *buffer) {
 	/* Place a game object in the start of the buffer, and
-	   treat the rest of the buffer as tile storage. */
+	   treat the rest of the buffer as tile storage, followed
+	   by storage for any optional features. */
+	size_t tile_count = (size_t)width * height;
 	struct minesweeper_game *game = (struct minesweeper_game *)buffer;
+	if (!is_valid_size(width, height, options))
+		return NULL;
 	game->tiles = (struct minesweeper_tile *)buffer + sizeof(struct minesweeper_game);
+	game->adjacent_flag_counts = NULL;
+	game->zero_region_labels = NULL;
+	game->zero_regions = NULL;
+	game->zero_region_fill_stack = NULL;
+	game->zero_region_count = 0;
+	layout_game_buffer(game, width, height, options);
+	/* Labelled on the first cascade, see open_single_tile() */
+	game->zero_regions_outdated = game->zero_region_labels != NULL;
+	if (game->adjacent_flag_counts != NULL)
+		memset(game->adjacent_flag_counts, 0, tile_count);
+	game->options = options;
 	game->tile_update_callback = NULL;
+	game->area_update_callback = NULL;
 	game->state = MINESWEEPER_PENDING_START;
 	game->width = width;
 	game->height = height;
@@ -18,13 +102,74 @@ struct minesweeper_game *minesweeper_init(unsigned width, unsigned height, float
 	game->opened_tile_count = 0;
 	game->selected_tile = NULL;
 	game->user_info = NULL;
-	memset(game->tiles, 0, sizeof(struct minesweeper_tile) * width * height);
-	generate_mines(game, mine_density);
+	game->change_tracker = NULL;
+	game->update_queue = NULL;
+	game->hint_cache = NULL;
+	game->cursor_index = NULL;
+	game->overview = NULL;
+	game->batch_has_changes = false;
+	cascade_init(&game->cascade);
+	game->checkpoint = NULL;
+	game->random_state = seed;
+	game->is_seeded = is_seeded;
+	game->mine_hash = 0;
+	game->visible_hash = 0;
+	memset(game->tiles, 0, sizeof(struct minesweeper_tile) * tile_count);
+	if (options & MINESWEEPER_DEFERRED_GENERATION) {
+		/* Only remember how many mines to place, see start_game() */
+		game->mine_count = width * height * mine_density;
+	} else {
+		generate_mines(game, mine_density);
+	}
 	return game;
 }
 
+struct minesweeper_game *minesweeper_init_with_options(unsigned width, unsigned height, float mine_density, unsigned options, uint8_t *buffer) {
+	return init_game(width, height, mine_density, options, false, 0, buffer);
+}
+
+struct minesweeper_game *minesweeper_init_with_seed(unsigned width, unsigned height, float mine_density, unsigned options, uint32_t seed, uint8_t *buffer) {
+	return init_game(width, height, mine_density, options, true, seed, buffer);
+}
+
 size_t minesweeper_minimum_buffer_size(unsigned width, unsigned height) {
-	return sizeof(struct minesweeper_game) + sizeof(struct minesweeper_tile) * width * height;
+	return minesweeper_buffer_size_with_options(width, height, 0);
+}
+
+size_t minesweeper_buffer_size_with_options(unsigned width, unsigned height, unsigned options) {
+	return layout_game_buffer(NULL, width, height, options);
+}
+
+static inline size_t bit_word_count(size_t bit_count) {
+	return (bit_count + 31) / 32;
+}
+
+size_t minesweeper_change_tracker_buffer_size(unsigned width, unsigned height) {
+	size_t tile_words = bit_word_count((size_t)width * height);
+	return sizeof(struct minesweeper_change_tracker) + sizeof(uint32_t) * (tile_words + bit_word_count(tile_words));
+}
+
+struct minesweeper_change_tracker *minesweeper_track_changes(struct minesweeper_game *game, uint8_t *buffer) {
+	/* Same layout as the game buffer: the tracker first, followed by its bitmaps */
+	struct minesweeper_change_tracker *tracker = (struct minesweeper_change_tracker *)buffer;
+	size_t tile_words = bit_word_count((size_t)game->width * game->height);
+	size_t summary_words = bit_word_count(tile_words);
+	tracker->tile_bits = (uint32_t *)(buffer + sizeof(struct minesweeper_change_tracker));
+	tracker->word_bits = tracker->tile_bits + tile_words;
+	tracker->changed_tile_count = 0;
+	memset(tracker->tile_bits, 0, sizeof(uint32_t) * (tile_words + summary_words));
+	game->change_tracker = tracker;
+	return tracker;
+}
+
+void mark_tile_changed(struct minesweeper_change_tracker *tracker, size_t index) {
+	size_t word = index / 32;
+	uint32_t mask = (uint32_t)1 << (index % 32);
+	if (!(tracker->tile_bits[word] & mask)) {
+		tracker->tile_bits[word] |= mask;
+		tracker->word_bits[word / 32] |= (uint32_t)1 << (word % 32);
+		tracker->changed_tile_count++;
+	}
 }
 
 bool is_out_of_bounds(struct minesweeper_game *b, unsigned x, unsigned y) {
@@ -39,25 +184,71 @@ bool is_out_of_bounds(struct minesweeper_game *b, unsigned x, unsigned y) {
 struct minesweeper_tile *minesweeper_get_tile_at(struct minesweeper_game *game, unsigned x, unsigned y) {
 	if (is_out_of_bounds(game, x, y))
 		return NULL;
-	return &game->tiles[game->width * y + x];
+	return &game->tiles[tile_index(game, x, y)];
 }
 
 void minesweeper_get_tile_location(struct minesweeper_game *game, struct minesweeper_tile *tile, unsigned *x, unsigned *y) {
-	unsigned tile_index = tile - game->tiles;
-	*y = tile_index / game->width;
-	*x = tile_index % game->width;
+	tile_index_location(game, tile - game->tiles, x, y);
+}
+
+static ALWAYS_INLINE void get_adjacent_tiles(struct minesweeper_game *game, enum topology topology, unsigned x, unsigned y, struct minesweeper_tile *adjacent_tiles[8]) {
+	/* Coordinates past the edges wrap around to large values, which
+	   minesweeper_get_tile_at() turns into NULL, unless on a torus */
+	unsigned left = x - 1, right = x + 1, up = y - 1, down = y + 1;
+	if (topology & TORUS) {
+		left = x > 0 ? left : game->width - 1;
+		right = right < game->width ? right : 0;
+		up = y > 0 ? up : game->height - 1;
+		down = down < game->height ? down : 0;
+	}
+	if (topology & HEX) {
+		unsigned other_left = y & 1 ? x : left, other_right = y & 1 ? right : x;
+		adjacent_tiles[0] = minesweeper_get_tile_at(game, other_left, up);
+		adjacent_tiles[1] = minesweeper_get_tile_at(game, other_right, up);
+		adjacent_tiles[2] = minesweeper_get_tile_at(game, left, y);
+		adjacent_tiles[3] = minesweeper_get_tile_at(game, right, y);
+		adjacent_tiles[4] = minesweeper_get_tile_at(game, other_left, down);
+		adjacent_tiles[5] = minesweeper_get_tile_at(game, other_right, down);
+		adjacent_tiles[6] = NULL;
+		adjacent_tiles[7] = NULL;
+		return;
+	}
+	adjacent_tiles[0] = minesweeper_get_tile_at(game, left, up);
+	adjacent_tiles[1] = minesweeper_get_tile_at(game, left, y);
+	adjacent_tiles[2] = minesweeper_get_tile_at(game, left, down);
+	adjacent_tiles[3] = minesweeper_get_tile_at(game, x, up);
+	adjacent_tiles[4] = minesweeper_get_tile_at(game, x, down);
+	adjacent_tiles[5] = minesweeper_get_tile_at(game, right, up);
+	adjacent_tiles[6] = minesweeper_get_tile_at(game, right, y);
+	adjacent_tiles[7] = minesweeper_get_tile_at(game, right, down);
+}
+
+static ALWAYS_INLINE unsigned adjacent_indices_with_topology(const struct minesweeper_game *game, enum topology topology, size_t index, size_t adjacent[8]) {
+	unsigned x = index % game->width, y = index / game->width;
+	struct span spans[MAX_ADJACENT_SPANS];
+	unsigned span_count = adjacent_spans(game, topology, x, x, y, spans);
+	unsigned i, ax, count = 0;
+	for (i = 0; i < span_count; i++) {
+		for (ax = spans[i].min_x; ax <= spans[i].max_x; ax++) {
+			if (ax != x || spans[i].y != y)
+				adjacent[count++] = (size_t)spans[i].y * game->width + ax;
+		}
+	}
+	return count;
+}
+
+unsigned adjacent_indices(const struct minesweeper_game *game, size_t index, size_t adjacent[8]) {
+	switch (game_topology(game)) {
+	case TORUS: return adjacent_indices_with_topology(game, TORUS, index, adjacent);
+	case HEX: return adjacent_indices_with_topology(game, HEX, index, adjacent);
+	case HEX_TORUS: return adjacent_indices_with_topology(game, HEX_TORUS, index, adjacent);
+	default: return adjacent_indices_with_topology(game, BOUNDED, index, adjacent);
+	}
 }
 
 void minesweeper_get_adjacent_tiles(struct minesweeper_game *game, struct minesweeper_tile *tile, struct minesweeper_tile *adjacent_tiles[8]) {
 	unsigned x, y; minesweeper_get_tile_location(game, tile, &x, &y);
-	adjacent_tiles[0] = minesweeper_get_tile_at(game, x - 1, y - 1);
-	adjacent_tiles[1] = minesweeper_get_tile_at(game, x - 1, y);
-	adjacent_tiles[2] = minesweeper_get_tile_at(game, x - 1, y + 1);
-	adjacent_tiles[3] = minesweeper_get_tile_at(game, x, y - 1);
-	adjacent_tiles[4] = minesweeper_get_tile_at(game, x, y + 1);
-	adjacent_tiles[5] = minesweeper_get_tile_at(game, x + 1, y - 1);
-	adjacent_tiles[6] = minesweeper_get_tile_at(game, x + 1, y);
-	adjacent_tiles[7] = minesweeper_get_tile_at(game, x + 1, y + 1);
+	DISPATCH_TOPOLOGY(get_adjacent_tiles, game, x, y, adjacent_tiles);
 }
 
 /**
@@ -89,70 +280,236 @@ void minesweeper_toggle_mine(struct minesweeper_game *game, struct minesweeper_t
 		return;
 	}
 	
+	before_tile_change(game, tile - game->tiles);
 	tile->has_mine = !tile->has_mine;
+	game->mine_hash ^= zobrist_key(row_major_index(game, tile), ZOBRIST_MINE);
+	if (game->overview != NULL && tile->is_opened)
+		overview_tile_changed(game, row_major_index(game, tile));
 	if (tile->has_mine) {
 		count_modifier = 1;
 	}
 	game->mine_count += count_modifier;
+	if (game->zero_region_labels != NULL)
+		game->zero_regions_outdated = true;
+	outdate_hints(game);
 
 	/* Increase or decrease the mine counts on all adjacent tiles */
 	minesweeper_get_adjacent_tiles(game, tile, adjacent_tiles);
 	for (i = 0; i < 8; i++) {
 		if (adjacent_tiles[i]) {
+			before_tile_change(game, adjacent_tiles[i] - game->tiles);
 			adjacent_tiles[i]->adjacent_mine_count += count_modifier;
 		}
 	}
 }
 
+/**
+ * Uniformly random number below limit, which may be larger than RAND_MAX.
+ * Seeded games use their own generator, a counter mixed with hash_32().
+ */
+static unsigned long random_below(struct minesweeper_game *game, unsigned long limit) {
+	unsigned long value;
+	if (game->is_seeded) {
+		game->random_state += 0x9E3779B9;
+		return hash_32(game->random_state) % limit;
+	}
+	value = rand();
+	if (limit > RAND_MAX)
+		value = value * ((unsigned long)RAND_MAX + 1) + rand();
+	return value % limit;
+}
+
 void generate_mines(struct minesweeper_game *game, float density) {
 	unsigned tile_count = game->width * game->height;
 	unsigned mine_count = tile_count * density;
 	unsigned i;
 	for (i = 0; i < mine_count; i++) {
-		struct minesweeper_tile *random_tile = &game->tiles[rand() % tile_count];
+		unsigned random_index = random_below(game, tile_count);
+		struct minesweeper_tile *random_tile = minesweeper_get_tile_at(game, random_index % game->width, random_index / game->width);
 		if (!random_tile->has_mine) {
 			minesweeper_toggle_mine(game, random_tile);
 		}
 	}
 }
 
+static inline bool is_safe_tile(struct minesweeper_tile *safe_tiles[9], const struct minesweeper_tile *tile) {
+	unsigned i;
+	for (i = 0; i < 9; i++) {
+		if (safe_tiles[i] == tile)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Place exactly game->mine_count mines, uniformly at random, except on
+ * the tile at (safe_x, safe_y) and its adjacent tiles. Random tiles are
+ * picked until enough have been changed, so on dense boards every
+ * allowed tile gets a mine first, and random mines are then removed.
+ * Either way, at most half of the allowed tiles are picked.
+ */
+static void generate_mines_around(struct minesweeper_game *game, unsigned safe_x, unsigned safe_y) {
+	unsigned tile_count = game->width * game->height;
+	struct minesweeper_tile *safe_tiles[9];
+	unsigned safe_count = 0, allowed_count, mine_count, change_count, i;
+	unsigned x, y;
+	bool fill;
+
+	safe_tiles[8] = minesweeper_get_tile_at(game, safe_x, safe_y);
+	minesweeper_get_adjacent_tiles(game, safe_tiles[8], safe_tiles);
+	for (i = 0; i < 9; i++) {
+		safe_count += safe_tiles[i] != NULL;
+	}
+	allowed_count = tile_count - safe_count;
+	mine_count = game->mine_count < allowed_count ? game->mine_count : allowed_count;
+	fill = mine_count > allowed_count / 2;
+	change_count = fill ? allowed_count - mine_count : mine_count;
+
+	game->mine_count = 0;
+	if (fill) {
+		for (y = 0; y < game->height; y++) {
+			for (x = 0; x < game->width; x++) {
+				struct minesweeper_tile *tile = minesweeper_get_tile_at(game, x, y);
+				if (!is_safe_tile(safe_tiles, tile))
+					minesweeper_toggle_mine(game, tile);
+			}
+		}
+	}
+	while (change_count > 0) {
+		unsigned long random_index = random_below(game, tile_count);
+		struct minesweeper_tile *random_tile;
+		x = random_index % game->width;
+		y = random_index / game->width;
+		random_tile = minesweeper_get_tile_at(game, x, y);
+		if (is_safe_tile(safe_tiles, random_tile) || random_tile->has_mine != fill)
+			continue;
+		minesweeper_toggle_mine(game, random_tile);
+		change_count--;
+	}
+}
+
+void record_tile_update(struct minesweeper_game *game, struct minesweeper_tile *tile) {
+	if (game->change_tracker != NULL) {
+		mark_tile_changed(game->change_tracker, row_major_index(game, tile));
+	}
+	if (game->update_queue != NULL) {
+		queue_tile_update(game->update_queue, row_major_index(game, tile), tile);
+	}
+	update_tile_indices(game, row_major_index(game, tile), tile);
+}
+
 void send_update_callback(struct minesweeper_game *game, struct minesweeper_tile *tile) {
+	record_tile_update(game, tile);
 	if (game->tile_update_callback != NULL) {
 		game->tile_update_callback(game, tile, game->user_info);
 	}
 }
 
+/**
+ * Adjusts the flag counts of all tiles adjacent to a tile whose
+ * flag was just toggled, in the same way minesweeper_toggle_mine()
+ * adjusts adjacent mine counts.
+ */
+void update_adjacent_flag_counts(struct minesweeper_game *game, struct minesweeper_tile *tile) {
+	uint8_t i;
+	struct minesweeper_tile *adjacent_tiles[8];
+	int8_t count_modifier = tile->has_flag ? 1 : -1;
+
+	minesweeper_get_adjacent_tiles(game, tile, adjacent_tiles);
+	for (i = 0; i < 8; i++) {
+		if (adjacent_tiles[i]) {
+			before_tile_change(game, adjacent_tiles[i] - game->tiles);
+			game->adjacent_flag_counts[adjacent_tiles[i] - game->tiles] += count_modifier;
+		}
+	}
+}
+
 void minesweeper_toggle_flag(struct minesweeper_game *game, struct minesweeper_tile *tile) {
 	if (tile && !tile->is_opened) {
+		before_tile_change(game, tile - game->tiles);
 		game->flag_count += tile->has_flag ? -1 : 1;
 		tile->has_flag = !tile->has_flag;
+		game->visible_hash ^= zobrist_key(row_major_index(game, tile), ZOBRIST_FLAG);
+		if (game->adjacent_flag_counts != NULL)
+			update_adjacent_flag_counts(game, tile);
+		if (game->zero_region_labels != NULL && !game->zero_regions_outdated)
+			update_zero_region_flag_counts(game, tile);
 		send_update_callback(game, tile);
 	}
 }
 
-static inline bool all_tiles_opened(struct minesweeper_game *game) {
+bool all_tiles_opened(struct minesweeper_game *game) {
 	return game->opened_tile_count == game->width * game->height - game->mine_count;
 }
 
-void open_adjacent_tiles(struct minesweeper_game *game, struct minesweeper_tile *tile);
+void cascade_init(struct minesweeper_cascade *cascade) {
+	cascade->queue_start = 0;
+	cascade->queue_length = 0;
+	cascade->pending_count = 0;
+	cascade->has_unqueued = false;
+	cascade->rescan_row = 0;
+}
+
+/**
+ * Position in the queue of the tile offset tiles after the first one.
+ */
+static inline unsigned queue_slot(const struct minesweeper_cascade *cascade, unsigned offset) {
+	unsigned slot = cascade->queue_start + offset;
+	return slot < cascade->queue_capacity ? slot : slot - cascade->queue_capacity;
+}
 
-void _open_tile(struct minesweeper_game *game, struct minesweeper_tile *tile, bool cascade) {
-	if (tile->is_opened) {
-		/* If this tile is already opened and has a mine count,
-		 * it should open all adjacent tiles instead. This mimics
-		 * the behaviour in the original minesweeper where you can
-		 * right click opened tiles to open adjacent tiles quickly. */
-		if (tile->adjacent_mine_count > 0 && tile->adjacent_mine_count == count_adjacent_flags(game, tile) && cascade)
-			open_adjacent_tiles(game, tile);
-		return;
+static inline void queue_pending(struct minesweeper_cascade *cascade, uint32_t index) {
+	cascade->queue[queue_slot(cascade, cascade->queue_length++)] = index;
+}
+
+static inline uint32_t dequeue_pending(struct minesweeper_cascade *cascade) {
+	uint32_t index = cascade->queue[cascade->queue_start];
+	cascade->queue_start = queue_slot(cascade, 1);
+	cascade->queue_length--;
+	return index;
+}
+
+static void mark_pending(struct minesweeper_game *game, struct minesweeper_cascade *cascade, struct minesweeper_tile *tile, unsigned x, unsigned y) {
+	tile->reserved = true;
+	if (cascade->pending_count++ == 0) {
+		cascade->queue_length = 0;
+		cascade->min_x = cascade->max_x = x;
+		cascade->min_y = cascade->max_y = y;
+		cascade->has_unqueued = false;
+	} else {
+		if (x < cascade->min_x)
+			cascade->min_x = x;
+		if (x > cascade->max_x)
+			cascade->max_x = x;
+		if (y < cascade->min_y)
+			cascade->min_y = y;
+		if (y > cascade->max_y)
+			cascade->max_y = y;
 	}
+	if (cascade->queue_length < cascade->queue_capacity)
+		queue_pending(cascade, (uint32_t)y * game->width + x);
+	else
+		cascade->has_unqueued = true;
+}
 
-	if (tile->has_flag) {
+/**
+ * Open a single unopened, unflagged tile. If it has no adjacent
+ * mines, it's marked as pending so that run_cascade() will open
+ * its adjacent tiles.
+ */
+static void open_single_tile(struct minesweeper_game *game, struct minesweeper_tile *tile, unsigned x, unsigned y, struct minesweeper_cascade *cascade) {
+	if (tile->is_opened || tile->has_flag) {
 		return;
 	}
 
+	/* Regions are labelled lazily, just before the first zero tile is opened */
+	if (game->zero_regions_outdated && is_zero_tile(tile))
+		label_zero_regions(game);
+
+	before_tile_change(game, tile - game->tiles);
 	tile->is_opened = true;
 	game->opened_tile_count += 1;
+	game->visible_hash ^= zobrist_key((size_t)y * game->width + x, ZOBRIST_OPENED);
 	send_update_callback(game, tile);
 
 	if (tile->has_mine) {
@@ -165,89 +522,184 @@ void _open_tile(struct minesweeper_game *game, struct minesweeper_tile *tile, bo
 		return;
 	}
 
-	if (tile->adjacent_mine_count != 0) {
+	/* Open the whole region at once when it is labelled, otherwise cascade */
+	if (tile->adjacent_mine_count == 0 && !open_zero_region(game, x, y)) {
+		mark_pending(game, cascade, tile, x, y);
+	}
+}
+
+/**
+ * Open all tiles adjacent to the horizontal run of tiles from x1 to x2 on row y.
+ */
+static ALWAYS_INLINE void open_adjacent_tiles(struct minesweeper_game *game, enum topology topology, unsigned x1, unsigned x2, unsigned y, struct minesweeper_cascade *cascade) {
+	struct span spans[MAX_ADJACENT_SPANS];
+	unsigned span_count = adjacent_spans(game, topology, x1, x2, y, spans);
+	unsigned i, ax;
+	for (i = 0; i < span_count; i++) {
+		for (ax = spans[i].min_x; ax <= spans[i].max_x; ax++) {
+			struct minesweeper_tile *tile = &game->tiles[tile_index(game, ax, spans[i].y)];
+			if (!tile->is_opened && !tile->has_flag)
+				open_single_tile(game, tile, ax, spans[i].y, cascade);
+		}
+	}
+}
+
+void _open_tile(struct minesweeper_game *game, struct minesweeper_tile *tile, struct minesweeper_cascade *cascade) {
+	unsigned x, y; minesweeper_get_tile_location(game, tile, &x, &y);
+	if (tile->is_opened) {
+		/* If this tile is already opened and has a mine count,
+		 * it should open all adjacent tiles instead. This mimics
+		 * the behaviour in the original minesweeper where you can
+		 * right click opened tiles to open adjacent tiles quickly. */
+		uint8_t adjacent_flags;
+		if (tile->adjacent_mine_count == 0)
+			return;
+		if (game->adjacent_flag_counts != NULL)
+			adjacent_flags = game->adjacent_flag_counts[tile - game->tiles];
+		else
+			adjacent_flags = count_adjacent_flags(game, tile);
+		if (tile->adjacent_mine_count == adjacent_flags)
+			DISPATCH_TOPOLOGY(open_adjacent_tiles, game, x, x, y, cascade);
 		return;
 	}
 
-	if (cascade)
-		open_adjacent_tiles(game, tile);
+	open_single_tile(game, tile, x, y, cascade);
 }
 
-void minesweeper_open_tile(struct minesweeper_game *game, struct minesweeper_tile *tile) {
-	if (game->state == MINESWEEPER_PENDING_START) {
-		game->state = MINESWEEPER_PLAYING;
+/**
+ * Queues the pending tiles that didn't fit in the queue, once it has run
+ * empty, by scanning the rows of their bounding box until the queue is
+ * full again. The next scan continues from the row where this one
+ * stopped. Returns the number of tiles checked.
+ */
+static unsigned long queue_unqueued_tiles(struct minesweeper_game *game, struct minesweeper_cascade *cascade) {
+	unsigned long checked_count = 0;
+	unsigned row_count = cascade->max_y - cascade->min_y + 1, i, x, y;
+	if (cascade->rescan_row < cascade->min_y || cascade->rescan_row > cascade->max_y)
+		cascade->rescan_row = cascade->min_y;
+	cascade->has_unqueued = false;
+	for (i = 0, y = cascade->rescan_row; i < row_count; i++, y = y < cascade->max_y ? y + 1 : cascade->min_y) {
+		for (x = cascade->min_x; x <= cascade->max_x; x++) {
+			if (!game->tiles[tile_index(game, x, y)].reserved)
+				continue;
+			/* Every tile found is unqueued, since the queue was empty */
+			if (cascade->queue_length == cascade->queue_capacity) {
+				cascade->has_unqueued = true;
+				cascade->rescan_row = y;
+				return checked_count + (x - cascade->min_x);
+			}
+			queue_pending(cascade, (uint32_t)y * game->width + x);
+		}
+		checked_count += cascade->max_x - cascade->min_x + 1;
+	}
+	return checked_count;
+}
+
+/**
+ * Both opening a tile and checking one for being pending count
+ * towards the budget of a cascade, since scanning a large area
+ * for unqueued tiles can take as long as opening them.
+ */
+static inline bool is_budget_spent(const struct minesweeper_game *game, unsigned start_count, unsigned long checked_count, unsigned max_tiles) {
+	return max_tiles != UNLIMITED_TILES && game->opened_tile_count - start_count + checked_count >= max_tiles;
+}
+
+static inline void clear_pending(struct minesweeper_game *game, struct minesweeper_cascade *cascade, unsigned x, unsigned y) {
+	struct minesweeper_tile *tile = &game->tiles[tile_index(game, x, y)];
+	/* A checkpoint may be saved while a cascade is stopped */
+	before_tile_change(game, tile - game->tiles);
+	tile->reserved = false;
+	cascade->pending_count--;
+}
 
-		// Delete any potential mine on the first opened tile
-		if (tile->has_mine) {
-			minesweeper_toggle_mine(game, tile);
+/**
+ * Opens the adjacent tiles of all pending tiles, which in turn may
+ * become pending, until none are left or the budget is spent, see
+ * is_budget_spent(). Instead of recursing, which could overflow the
+ * stack on large boards, pending tiles are taken from the queue in the
+ * order they were opened, so the cascade only costs as much as the
+ * tiles it opens, whatever the shape of the area. The pending tiles
+ * next to a dequeued tile on its row are handled along with it, and
+ * their own entries in the queue are skipped when they come up.
+ */
+static ALWAYS_INLINE void cascade_with_topology(struct minesweeper_game *game, enum topology topology, struct minesweeper_cascade *cascade, unsigned max_tiles) {
+	unsigned start_count = game->opened_tile_count;
+	unsigned long checked_count = 0;
+	while (cascade->pending_count > 0) {
+		uint32_t index;
+		unsigned x, y, run_start, run_end;
+		if (cascade->queue_length == 0) {
+			checked_count += queue_unqueued_tiles(game, cascade);
+			/* Nothing was found, so nothing is pending after all */
+			if (cascade->queue_length == 0)
+				cascade->pending_count = 0;
+			continue;
 		}
+		index = dequeue_pending(cascade);
+		x = index % game->width;
+		y = index / game->width;
+		if (!game->tiles[tile_index(game, x, y)].reserved)
+			continue;
+		clear_pending(game, cascade, x, y);
+		for (run_start = x; run_start > 0 && game->tiles[tile_index(game, run_start - 1, y)].reserved; run_start--)
+			clear_pending(game, cascade, run_start - 1, y);
+		for (run_end = x; run_end + 1 < game->width && game->tiles[tile_index(game, run_end + 1, y)].reserved; run_end++)
+			clear_pending(game, cascade, run_end + 1, y);
+		open_adjacent_tiles(game, topology, run_start, run_end, y, cascade);
+		/* Every pending tile is still queued or marked, so
+		 * stopping anywhere leaves the rest for the next call */
+		if (is_budget_spent(game, start_count, checked_count, max_tiles))
+			return;
 	}
-	_open_tile(game, tile, true);
 }
 
-void minesweeper_space_tile(struct minesweeper_game *game, struct minesweeper_tile *tile) {
+bool run_cascade(struct minesweeper_game *game, struct minesweeper_cascade *cascade, unsigned max_tiles) {
+	DISPATCH_TOPOLOGY(cascade_with_topology, game, cascade, max_tiles);
+	return cascade->pending_count == 0;
+}
+
+void start_game(struct minesweeper_game *game, struct minesweeper_tile *first_tile) {
 	if (game->state == MINESWEEPER_PENDING_START) {
 		game->state = MINESWEEPER_PLAYING;
 
-		// Delete any potential mine on the first opened tile
-		if (tile->has_mine) {
-			minesweeper_toggle_mine(game, tile);
+		if (game->options & MINESWEEPER_DEFERRED_GENERATION) {
+			unsigned x, y;
+			minesweeper_get_tile_location(game, first_tile, &x, &y);
+			generate_mines_around(game, x, y);
+		} else if (first_tile->has_mine) {
+			// Delete any potential mine on the first opened tile
+			minesweeper_toggle_mine(game, first_tile);
 		}
 	}
-
-	if (tile->is_opened) {
-		_open_tile(game, tile, true);
-	} else {
-		minesweeper_toggle_flag(game, tile);
-	}
 }
 
-void open_line_segments(struct minesweeper_game *game, unsigned x1, unsigned x2, unsigned y) {
-	unsigned x;
-	struct minesweeper_tile *tile;
-	for (x = x1; x <= x2 && (tile = minesweeper_get_tile_at(game, x, y)); x++) {
-		if (!tile->is_opened)
-			_open_tile(game, tile, true);
-	}
+void minesweeper_open_tile(struct minesweeper_game *game, struct minesweeper_tile *tile) {
+	minesweeper_open_tile_with_budget(game, tile, UNLIMITED_TILES);
 }
 
-void open_adjacent_tiles(struct minesweeper_game *game, struct minesweeper_tile *tile) {
-	unsigned tile_index = tile - game->tiles;
-	unsigned ty = tile_index / game->width;
-	unsigned tx = tile_index % game->width;
-	unsigned lx, rx;
-	struct minesweeper_tile *subtile;
+bool minesweeper_open_tile_with_budget(struct minesweeper_game *game, struct minesweeper_tile *tile, unsigned max_tiles) {
+	start_game(game, tile);
+	/* Tiles pending from a stopped cascade are in the same
+	 * cascade, since they're marked on the same tiles */
+	_open_tile(game, tile, &game->cascade);
+	return run_cascade(game, &game->cascade, max_tiles);
+}
 
-	// Search for left boundary
-	for (lx = tx - 1; (subtile = minesweeper_get_tile_at(game, lx, ty)); lx--) {
-		if (subtile->is_opened && subtile->adjacent_mine_count != 0)
-			break;
-		_open_tile(game, subtile, false);
-		if (subtile->adjacent_mine_count != 0)
-			break;
-	}
+bool minesweeper_continue_cascade(struct minesweeper_game *game, unsigned max_tiles) {
+	return run_cascade(game, &game->cascade, max_tiles);
+}
 
-	// Re-adjust value if loop broke out because of out-of-bounds
-	if (is_out_of_bounds(game, lx, ty))
-		lx++;
+void minesweeper_space_tile(struct minesweeper_game *game, struct minesweeper_tile *tile) {
+	/* With deferred generation, only opening a tile places the mines */
+	if (!(game->options & MINESWEEPER_DEFERRED_GENERATION))
+		start_game(game, tile);
 
-	// Search for right boundary
-	for (rx = tx + 1; (subtile = minesweeper_get_tile_at(game, rx, ty)); rx++) {
-		if (subtile->is_opened && subtile->adjacent_mine_count != 0)
-			break;
-		_open_tile(game, subtile, false);
-		if (subtile->adjacent_mine_count != 0)
-			break;
+	if (tile->is_opened) {
+		_open_tile(game, tile, &game->cascade);
+		run_cascade(game, &game->cascade, UNLIMITED_TILES);
+	} else {
+		minesweeper_toggle_flag(game, tile);
 	}
-
-	// Re-adjust value if loop broke out because of out-of-bounds
-	if (is_out_of_bounds(game, rx, ty))
-		rx--;
-
-	// Open line(s) above
-	open_line_segments(game, lx, rx, ty - 1);
-	// Open line(s) below
-	open_line_segments(game,lx, rx, ty + 1);
 }
 
 void minesweeper_set_cursor(struct minesweeper_game *game, unsigned x, unsigned y) {
@@ -265,6 +717,8 @@ void minesweeper_move_cursor(struct minesweeper_game *game, enum direction direc
 	}
 
 	minesweeper_get_tile_location(game, game->selected_tile, &x, &y);
+	if (game->options & MINESWEEPER_TORUS)
+		should_wrap = true;
 	switch (direction) {
 	case LEFT:
 		if (x != 0)
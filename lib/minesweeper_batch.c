@@ -0,0 +1,114 @@
+#include <minesweeper_batch.h>
+#include "minesweeper_internal.h"
+
+void apply_action(struct minesweeper_game *game, const struct minesweeper_action *action) {
+	struct minesweeper_tile *tile = &game->tiles[tile_index(game, action->x, action->y)];
+	switch (action->type) {
+	case MINESWEEPER_ACTION_OPEN:
+		minesweeper_open_tile(game, tile);
+		break;
+	case MINESWEEPER_ACTION_TOGGLE_FLAG:
+		minesweeper_toggle_flag(game, tile);
+		break;
+	case MINESWEEPER_ACTION_SPACE:
+		minesweeper_space_tile(game, tile);
+		break;
+	}
+}
+
+enum minesweeper_action_result validate_action(const struct minesweeper_game *game, const struct minesweeper_action *action) {
+	if (action->x >= game->width || action->y >= game->height)
+		return MINESWEEPER_ACTION_OUT_OF_BOUNDS;
+	if (action->type > MINESWEEPER_ACTION_SPACE)
+		return MINESWEEPER_ACTION_INVALID_TYPE;
+	return MINESWEEPER_ACTION_NO_CHANGE;
+}
+
+static inline bool is_game_over(const struct minesweeper_game *game) {
+	return game->state == MINESWEEPER_GAME_OVER || game->state == MINESWEEPER_WIN;
+}
+
+/**
+ * While a batch is applied with an area callback, these replace the
+ * callbacks of the game, and collect the bounding box of every change
+ * in the game itself.
+ */
+static void add_to_batch_area(struct minesweeper_game *game, unsigned min_x, unsigned min_y, unsigned max_x, unsigned max_y, void *user_info) {
+	(void)user_info;
+	if (!game->batch_has_changes) {
+		game->batch_min_x = min_x;
+		game->batch_min_y = min_y;
+		game->batch_max_x = max_x;
+		game->batch_max_y = max_y;
+		game->batch_has_changes = true;
+		return;
+	}
+	if (min_x < game->batch_min_x)
+		game->batch_min_x = min_x;
+	if (min_y < game->batch_min_y)
+		game->batch_min_y = min_y;
+	if (max_x > game->batch_max_x)
+		game->batch_max_x = max_x;
+	if (max_y > game->batch_max_y)
+		game->batch_max_y = max_y;
+}
+
+static void add_tile_to_batch_area(struct minesweeper_game *game, struct minesweeper_tile *tile, void *user_info) {
+	unsigned x, y;
+	minesweeper_get_tile_location(game, tile, &x, &y);
+	add_to_batch_area(game, x, y, x, y, user_info);
+}
+
+size_t minesweeper_apply_actions(struct minesweeper_game *game, const struct minesweeper_action *actions, size_t count, enum minesweeper_action_result *results) {
+	minesweeper_callback tile_update_callback = game->tile_update_callback;
+	minesweeper_area_callback area_update_callback = game->area_update_callback;
+	size_t applied_count = 0;
+	size_t i;
+
+	/* Validate everything first, so that applying needs no checks */
+	if (results != NULL) {
+		for (i = 0; i < count; i++) {
+			results[i] = validate_action(game, &actions[i]);
+		}
+	}
+
+	/* Collect the changed area instead of sending callbacks per tile */
+	if (area_update_callback != NULL) {
+		game->batch_has_changes = false;
+		game->tile_update_callback = &add_tile_to_batch_area;
+		game->area_update_callback = &add_to_batch_area;
+	}
+
+	for (i = 0; i < count; i++) {
+		enum minesweeper_action_result result = results != NULL ? results[i] : validate_action(game, &actions[i]);
+		enum minesweeper_game_state state = game->state;
+		unsigned opened_tile_count = game->opened_tile_count;
+		unsigned flag_count = game->flag_count;
+
+		if (result != MINESWEEPER_ACTION_NO_CHANGE)
+			continue;
+		if (is_game_over(game)) {
+			for (; results != NULL && i < count; i++) {
+				if (results[i] == MINESWEEPER_ACTION_NO_CHANGE)
+					results[i] = MINESWEEPER_ACTION_SKIPPED;
+			}
+			break;
+		}
+
+		apply_action(game, &actions[i]);
+		/* Every action that changes a tile also changes one of these */
+		if (game->state != state || game->opened_tile_count != opened_tile_count || game->flag_count != flag_count) {
+			applied_count++;
+			if (results != NULL)
+				results[i] = MINESWEEPER_ACTION_APPLIED;
+		}
+	}
+
+	if (area_update_callback != NULL) {
+		game->tile_update_callback = tile_update_callback;
+		game->area_update_callback = area_update_callback;
+		if (game->batch_has_changes)
+			area_update_callback(game, game->batch_min_x, game->batch_min_y, game->batch_max_x, game->batch_max_y, game->user_info);
+	}
+	return applied_count;
+}
@@ -0,0 +1,174 @@
+#include <minesweeper_checkpoint.h>
+#include <string.h>
+#include "minesweeper_internal.h"
+
+static inline size_t page_count(struct minesweeper_game *game) {
+	return ((size_t)game->width * game->height + MINESWEEPER_CHECKPOINT_PAGE_SIZE - 1) / MINESWEEPER_CHECKPOINT_PAGE_SIZE;
+}
+
+/**
+ * Bytes stored per page: the tiles, followed by
+ * their flag counts when those are tracked.
+ */
+static inline size_t page_bytes(struct minesweeper_game *game) {
+	return game->adjacent_flag_counts != NULL ? 2 * MINESWEEPER_CHECKPOINT_PAGE_SIZE : MINESWEEPER_CHECKPOINT_PAGE_SIZE;
+}
+
+/**
+ * Number of tiles in a page, which is less than a whole page
+ * for the last one when the tile count isn't a multiple of it.
+ */
+static inline size_t page_length(struct minesweeper_game *game, size_t page) {
+	size_t remaining = (size_t)game->width * game->height - page * MINESWEEPER_CHECKPOINT_PAGE_SIZE;
+	return remaining < MINESWEEPER_CHECKPOINT_PAGE_SIZE ? remaining : MINESWEEPER_CHECKPOINT_PAGE_SIZE;
+}
+
+size_t minesweeper_checkpoint_buffer_size(struct minesweeper_game *game, unsigned page_capacity) {
+	return sizeof(struct minesweeper_checkpoint)
+		+ sizeof(uint32_t) * ((page_count(game) + 31) / 32)
+		+ sizeof(uint32_t) * page_capacity
+		+ page_bytes(game) * page_capacity;
+}
+
+struct minesweeper_checkpoint *minesweeper_init_checkpoint(struct minesweeper_game *game, unsigned page_capacity, uint8_t *buffer) {
+	/* Same layout as the game buffer: the checkpoint first, followed by its storage */
+	struct minesweeper_checkpoint *checkpoint = (struct minesweeper_checkpoint *)buffer;
+	size_t bit_words = (page_count(game) + 31) / 32;
+	checkpoint->saved_page_bits = (uint32_t *)(buffer + sizeof(struct minesweeper_checkpoint));
+	checkpoint->saved_pages = checkpoint->saved_page_bits + bit_words;
+	checkpoint->page_storage = (uint8_t *)(checkpoint->saved_pages + page_capacity);
+	checkpoint->page_capacity = page_capacity;
+	checkpoint->saved_page_count = 0;
+	checkpoint->overflowed = false;
+	checkpoint->previous = NULL;
+	memset(checkpoint->saved_page_bits, 0, sizeof(uint32_t) * bit_words);
+	return checkpoint;
+}
+
+void minesweeper_save_checkpoint(struct minesweeper_game *game, struct minesweeper_checkpoint *checkpoint) {
+	/* The page bits are always left cleared, so saving doesn't depend on the board size */
+	checkpoint->previous = game->checkpoint;
+	checkpoint->saved_page_count = 0;
+	checkpoint->overflowed = false;
+	checkpoint->state = game->state;
+	checkpoint->mine_count = game->mine_count;
+	checkpoint->flag_count = game->flag_count;
+	checkpoint->opened_tile_count = game->opened_tile_count;
+	checkpoint->random_state = game->random_state;
+	checkpoint->mine_hash = game->mine_hash;
+	checkpoint->visible_hash = game->visible_hash;
+	checkpoint->cascade = game->cascade;
+	game->checkpoint = checkpoint;
+}
+
+/**
+ * Add a page to a checkpoint, unless it's already in there. Returns
+ * false, and marks the checkpoint as overflowed, if it's full.
+ */
+static bool add_page(struct minesweeper_checkpoint *checkpoint, size_t page, const uint8_t *contents, size_t size) {
+	if (is_page_saved(checkpoint, page))
+		return true;
+	if (checkpoint->saved_page_count == checkpoint->page_capacity) {
+		checkpoint->overflowed = true;
+		return false;
+	}
+	checkpoint->saved_page_bits[page / 32] |= (uint32_t)1 << (page % 32);
+	memcpy(checkpoint->page_storage + checkpoint->saved_page_count * size, contents, size);
+	checkpoint->saved_pages[checkpoint->saved_page_count++] = page;
+	return true;
+}
+
+void save_checkpoint_page(struct minesweeper_game *game, size_t page) {
+	uint8_t contents[2 * MINESWEEPER_CHECKPOINT_PAGE_SIZE];
+	size_t length = page_length(game, page);
+	memcpy(contents, (uint8_t *)game->tiles + page * MINESWEEPER_CHECKPOINT_PAGE_SIZE, length);
+	if (game->adjacent_flag_counts != NULL)
+		memcpy(contents + MINESWEEPER_CHECKPOINT_PAGE_SIZE, game->adjacent_flag_counts + page * MINESWEEPER_CHECKPOINT_PAGE_SIZE, length);
+	add_page(game->checkpoint, page, contents, page_bytes(game));
+}
+
+static void restore_page(struct minesweeper_game *game, size_t page, const uint8_t *contents) {
+	size_t first = page * MINESWEEPER_CHECKPOINT_PAGE_SIZE;
+	size_t length = page_length(game, page);
+	uint8_t *tile_bytes = (uint8_t *)game->tiles + first;
+	size_t i;
+
+	if (game->adjacent_flag_counts != NULL)
+		memcpy(game->adjacent_flag_counts + first, contents + MINESWEEPER_CHECKPOINT_PAGE_SIZE, length);
+	for (i = 0; i < length; i++) {
+		struct minesweeper_tile *tile = &game->tiles[first + i];
+		struct minesweeper_tile previous = *tile;
+		if (tile_bytes[i] == contents[i])
+			continue;
+		tile_bytes[i] = contents[i];
+
+		if (previous.has_mine != tile->has_mine) {
+			outdate_hints(game);
+			if (game->overview != NULL && tile->is_opened)
+				overview_tile_changed(game, row_major_index(game, tile));
+		}
+		/* Relabelling also finds which regions are no longer opened */
+		if (game->zero_region_labels != NULL) {
+			if (previous.has_mine != tile->has_mine || (previous.is_opened && !tile->is_opened))
+				game->zero_regions_outdated = true;
+			if (previous.has_flag != tile->has_flag && !game->zero_regions_outdated)
+				update_zero_region_flag_counts(game, tile);
+		}
+		if (previous.is_opened != tile->is_opened || previous.has_flag != tile->has_flag)
+			send_update_callback(game, tile);
+	}
+}
+
+bool minesweeper_rollback(struct minesweeper_game *game) {
+	struct minesweeper_checkpoint *checkpoint = game->checkpoint;
+	size_t size = page_bytes(game);
+	unsigned i;
+
+	if (checkpoint == NULL || checkpoint->overflowed)
+		return false;
+
+	game->state = checkpoint->state;
+	game->mine_count = checkpoint->mine_count;
+	game->flag_count = checkpoint->flag_count;
+	game->opened_tile_count = checkpoint->opened_tile_count;
+	game->random_state = checkpoint->random_state;
+	game->mine_hash = checkpoint->mine_hash;
+	game->visible_hash = checkpoint->visible_hash;
+	/* The pending tiles are restored along with the tiles, but the queue
+	 * isn't, so find them again as if none of them fit in the queue */
+	game->cascade = checkpoint->cascade;
+	game->cascade.queue_length = 0;
+	game->cascade.has_unqueued = game->cascade.pending_count > 0;
+	for (i = 0; i < checkpoint->saved_page_count; i++) {
+		uint32_t page = checkpoint->saved_pages[i];
+		restore_page(game, page, checkpoint->page_storage + i * size);
+		checkpoint->saved_page_bits[page / 32] &= ~((uint32_t)1 << (page % 32));
+	}
+	checkpoint->saved_page_count = 0;
+	return true;
+}
+
+void minesweeper_release_checkpoint(struct minesweeper_game *game) {
+	struct minesweeper_checkpoint *checkpoint = game->checkpoint;
+	struct minesweeper_checkpoint *previous;
+	size_t size = page_bytes(game);
+	unsigned i;
+
+	if (checkpoint == NULL)
+		return;
+	previous = checkpoint->previous;
+
+	/* Pages that the previous checkpoint hasn't saved yet were unchanged
+	 * since it was saved, until this checkpoint saved them */
+	for (i = 0; i < checkpoint->saved_page_count; i++) {
+		uint32_t page = checkpoint->saved_pages[i];
+		if (previous != NULL && !previous->overflowed)
+			add_page(previous, page, checkpoint->page_storage + i * size, size);
+		checkpoint->saved_page_bits[page / 32] &= ~((uint32_t)1 << (page % 32));
+	}
+	if (previous != NULL && checkpoint->overflowed)
+		previous->overflowed = true;
+	checkpoint->saved_page_count = 0;
+	checkpoint->overflowed = false;
+	game->checkpoint = previous;
+}
@@ -0,0 +1,322 @@
+#include <minesweeper_cursor.h>
+#include <string.h>
+#include "minesweeper_internal.h"
+
+/**
+ * Searches work on row-major tile indices. With a cursor index, these are
+ * mapped to bit positions, where each row is padded to whole words, so
+ * that the padding bits are never set and the order stays the same.
+ * A search first checks the rest of the starting word, and then uses the
+ * word summary to skip 32 empty words at a time. Searches up and down a
+ * column work the same way on the column-major copy of each bitmap.
+ */
+
+#define NOT_FOUND SIZE_MAX
+
+static inline size_t bitmap_word_count(unsigned width, unsigned height) {
+	return (size_t)height * ((width + 31) / 32);
+}
+
+/**
+ * Words for a bitmap with line_count lines of line_length bits, and its summary.
+ */
+static inline size_t bitmap_size(unsigned line_length, unsigned line_count) {
+	size_t tile_words = bitmap_word_count(line_length, line_count);
+	return tile_words + (tile_words + 31) / 32;
+}
+
+size_t minesweeper_cursor_index_buffer_size(unsigned width, unsigned height) {
+	return sizeof(struct minesweeper_cursor_index) + sizeof(uint32_t) * MINESWEEPER_TILE_KIND_COUNT * (bitmap_size(width, height) + bitmap_size(height, width));
+}
+
+static bool is_frontier(struct minesweeper_game *game, unsigned x, unsigned y) {
+	size_t adjacent[8];
+	unsigned count, i;
+	if (game->tiles[tile_index(game, x, y)].is_opened)
+		return false;
+	count = adjacent_indices(game, (size_t)y * game->width + x, adjacent);
+	for (i = 0; i < count; i++) {
+		if (game->tiles[tile_index(game, adjacent[i] % game->width, adjacent[i] / game->width)].is_opened)
+			return true;
+	}
+	return false;
+}
+
+static bool is_kind(struct minesweeper_game *game, enum minesweeper_tile_kind kind, unsigned x, unsigned y) {
+	const struct minesweeper_tile *tile = &game->tiles[tile_index(game, x, y)];
+	switch (kind) {
+	case MINESWEEPER_UNOPENED_TILE:
+		return !tile->is_opened;
+	case MINESWEEPER_UNFLAGGED_TILE:
+		return !tile->is_opened && !tile->has_flag;
+	case MINESWEEPER_FRONTIER_TILE:
+		return is_frontier(game, x, y);
+	default:
+		return false;
+	}
+}
+
+static inline size_t bit_position(const struct minesweeper_cursor_index *index, unsigned width, size_t tile) {
+	return tile / width * index->row_words * 32 + tile % width;
+}
+
+static inline bool test_bit(const struct minesweeper_tile_bitmap *bitmap, size_t bit) {
+	return (bitmap->tile_bits[bit / 32] >> (bit % 32)) & 1;
+}
+
+static void set_bit(struct minesweeper_tile_bitmap *bitmap, size_t bit, bool value) {
+	size_t word = bit / 32;
+	if (value) {
+		bitmap->tile_bits[word] |= (uint32_t)1 << (bit % 32);
+		bitmap->word_bits[word / 32] |= (uint32_t)1 << (word % 32);
+	} else {
+		bitmap->tile_bits[word] &= ~((uint32_t)1 << (bit % 32));
+		if (bitmap->tile_bits[word] == 0)
+			bitmap->word_bits[word / 32] &= ~((uint32_t)1 << (word % 32));
+	}
+}
+
+static inline size_t column_bit_position(const struct minesweeper_cursor_index *index, unsigned x, unsigned y) {
+	return (size_t)x * index->column_words * 32 + y;
+}
+
+/**
+ * Sets the bit of a tile in both the row-major and the column-major bitmap of a kind.
+ */
+static void set_kind(struct minesweeper_cursor_index *index, enum minesweeper_tile_kind kind, unsigned x, unsigned y, bool value) {
+	set_bit(&index->bitmaps[kind], (size_t)y * index->row_words * 32 + x, value);
+	set_bit(&index->column_bitmaps[kind], column_bit_position(index, x, y), value);
+}
+
+static void init_bitmap(struct minesweeper_tile_bitmap *bitmap, uint32_t *bits, unsigned line_length, unsigned line_count) {
+	bitmap->tile_bits = bits;
+	bitmap->word_bits = bits + bitmap_word_count(line_length, line_count);
+}
+
+struct minesweeper_cursor_index *minesweeper_index_cursor_jumps(struct minesweeper_game *game, uint8_t *buffer) {
+	struct minesweeper_cursor_index *index = (struct minesweeper_cursor_index *)buffer;
+	uint32_t *bits = (uint32_t *)(buffer + sizeof(struct minesweeper_cursor_index));
+	unsigned kind, x, y;
+
+	index->row_words = (game->width + 31) / 32;
+	index->column_words = (game->height + 31) / 32;
+	for (kind = 0; kind < MINESWEEPER_TILE_KIND_COUNT; kind++) {
+		init_bitmap(&index->bitmaps[kind], bits, game->width, game->height);
+		bits += bitmap_size(game->width, game->height);
+		init_bitmap(&index->column_bitmaps[kind], bits, game->height, game->width);
+		bits += bitmap_size(game->height, game->width);
+	}
+	memset(index->bitmaps[0].tile_bits, 0, (uint8_t *)bits - (uint8_t *)index->bitmaps[0].tile_bits);
+
+	for (y = 0; y < game->height; y++) {
+		for (x = 0; x < game->width; x++) {
+			for (kind = 0; kind < MINESWEEPER_TILE_KIND_COUNT; kind++) {
+				if (is_kind(game, kind, x, y))
+					set_kind(index, kind, x, y, true);
+			}
+		}
+	}
+	game->cursor_index = index;
+	return index;
+}
+
+void cursor_index_tile_changed(struct minesweeper_game *game, size_t tile, const struct minesweeper_tile *changed_tile) {
+	struct minesweeper_cursor_index *index = game->cursor_index;
+	unsigned x = tile % game->width, y = tile / game->width;
+	bool was_opened = !test_bit(&index->bitmaps[MINESWEEPER_UNOPENED_TILE], bit_position(index, game->width, tile));
+	size_t adjacent[8];
+	unsigned count, i;
+
+	set_kind(index, MINESWEEPER_UNOPENED_TILE, x, y, !changed_tile->is_opened);
+	set_kind(index, MINESWEEPER_UNFLAGGED_TILE, x, y, !changed_tile->is_opened && !changed_tile->has_flag);
+	if (changed_tile->is_opened == was_opened)
+		return;
+
+	/* Opening a tile makes its unopened neighbours frontier tiles, while
+	 * closing one again can take that away, so those are checked again */
+	set_kind(index, MINESWEEPER_FRONTIER_TILE, x, y, is_frontier(game, x, y));
+	count = adjacent_indices(game, tile, adjacent);
+	for (i = 0; i < count; i++) {
+		unsigned ax = adjacent[i] % game->width, ay = adjacent[i] / game->width;
+		if (changed_tile->is_opened)
+			set_kind(index, MINESWEEPER_FRONTIER_TILE, ax, ay, !game->tiles[tile_index(game, ax, ay)].is_opened);
+		else
+			set_kind(index, MINESWEEPER_FRONTIER_TILE, ax, ay, is_frontier(game, ax, ay));
+	}
+}
+
+/**
+ * First set bit in [from, end), or NOT_FOUND.
+ */
+static size_t find_next_bit(const struct minesweeper_tile_bitmap *bitmap, size_t from, size_t end) {
+	size_t word = from / 32, end_word = (end + 31) / 32, summary, result;
+	uint32_t bits, summary_bits;
+
+	if (from >= end)
+		return NOT_FOUND;
+	bits = bitmap->tile_bits[word] & (~(uint32_t)0 << (from % 32));
+	if (bits == 0) {
+		if (++word >= end_word)
+			return NOT_FOUND;
+		summary = word / 32;
+		summary_bits = bitmap->word_bits[summary] & (~(uint32_t)0 << (word % 32));
+		while (summary_bits == 0) {
+			if (++summary * 32 >= end_word)
+				return NOT_FOUND;
+			summary_bits = bitmap->word_bits[summary];
+		}
+		word = summary * 32 + count_trailing_zeros(summary_bits);
+		bits = bitmap->tile_bits[word];
+	}
+	result = word * 32 + count_trailing_zeros(bits);
+	return result < end ? result : NOT_FOUND;
+}
+
+/**
+ * Last set bit in [first, from], or NOT_FOUND.
+ */
+static size_t find_previous_bit(const struct minesweeper_tile_bitmap *bitmap, size_t from, size_t first) {
+	size_t word = from / 32, first_word = first / 32, summary, result;
+	uint32_t bits, summary_bits;
+
+	bits = bitmap->tile_bits[word] & (~(uint32_t)0 >> (31 - from % 32));
+	if (bits == 0) {
+		if (word-- == first_word)
+			return NOT_FOUND;
+		summary = word / 32;
+		summary_bits = bitmap->word_bits[summary] & (~(uint32_t)0 >> (31 - word % 32));
+		while (summary_bits == 0) {
+			if (summary-- == first_word / 32)
+				return NOT_FOUND;
+			summary_bits = bitmap->word_bits[summary];
+		}
+		word = summary * 32 + 31 - count_leading_zeros(summary_bits);
+		bits = bitmap->tile_bits[word];
+	}
+	result = word * 32 + 31 - count_leading_zeros(bits);
+	return result >= first ? result : NOT_FOUND;
+}
+
+/**
+ * First tile of a kind with a row-major index in [from, end), or NOT_FOUND.
+ */
+static size_t find_next(struct minesweeper_game *game, enum minesweeper_tile_kind kind, size_t from, size_t end) {
+	struct minesweeper_cursor_index *index = game->cursor_index;
+	size_t i, bit;
+	if (index != NULL) {
+		bit = find_next_bit(&index->bitmaps[kind], bit_position(index, game->width, from), bit_position(index, game->width, end));
+		return bit == NOT_FOUND ? NOT_FOUND : bit / (index->row_words * 32) * game->width + bit % (index->row_words * 32);
+	}
+	for (i = from; i < end; i++) {
+		if (is_kind(game, kind, i % game->width, i / game->width))
+			return i;
+	}
+	return NOT_FOUND;
+}
+
+/**
+ * Last tile of a kind with a row-major index in [first, from], or NOT_FOUND.
+ */
+static size_t find_previous(struct minesweeper_game *game, enum minesweeper_tile_kind kind, size_t from, size_t first) {
+	struct minesweeper_cursor_index *index = game->cursor_index;
+	size_t i, bit;
+	if (index != NULL) {
+		bit = find_previous_bit(&index->bitmaps[kind], bit_position(index, game->width, from), bit_position(index, game->width, first));
+		return bit == NOT_FOUND ? NOT_FOUND : bit / (index->row_words * 32) * game->width + bit % (index->row_words * 32);
+	}
+	for (i = from + 1; i-- > first; ) {
+		if (is_kind(game, kind, i % game->width, i / game->width))
+			return i;
+	}
+	return NOT_FOUND;
+}
+
+/**
+ * Nearest row above or below y in column x with a tile of a kind, or NOT_FOUND.
+ */
+static size_t find_in_column(struct minesweeper_game *game, enum minesweeper_tile_kind kind, unsigned x, unsigned y, bool up) {
+	struct minesweeper_cursor_index *index = game->cursor_index;
+	unsigned ay;
+	size_t bit;
+	if (index != NULL) {
+		const struct minesweeper_tile_bitmap *column = &index->column_bitmaps[kind];
+		size_t column_start = column_bit_position(index, x, 0);
+		if (up)
+			bit = y > 0 ? find_previous_bit(column, column_start + y - 1, column_start) : NOT_FOUND;
+		else
+			bit = find_next_bit(column, column_start + y + 1, column_start + game->height);
+		return bit == NOT_FOUND ? NOT_FOUND : bit - column_start;
+	}
+	if (up) {
+		for (ay = y; ay-- > 0; ) {
+			if (is_kind(game, kind, x, ay))
+				return ay;
+		}
+	} else {
+		for (ay = y + 1; ay < game->height; ay++) {
+			if (is_kind(game, kind, x, ay))
+				return ay;
+		}
+	}
+	return NOT_FOUND;
+}
+
+bool minesweeper_jump_cursor(struct minesweeper_game *game, enum minesweeper_tile_kind kind, bool backwards, bool should_wrap) {
+	size_t tile_count = (size_t)game->width * game->height;
+	size_t current, found;
+
+	if (kind >= MINESWEEPER_TILE_KIND_COUNT || tile_count == 0)
+		return false;
+	if (game->selected_tile == NULL) {
+		found = backwards ? find_previous(game, kind, tile_count - 1, 0) : find_next(game, kind, 0, tile_count);
+	} else {
+		current = row_major_index(game, game->selected_tile);
+		if (backwards) {
+			found = current > 0 ? find_previous(game, kind, current - 1, 0) : NOT_FOUND;
+			if (found == NOT_FOUND && should_wrap)
+				found = find_previous(game, kind, tile_count - 1, current);
+		} else {
+			found = find_next(game, kind, current + 1, tile_count);
+			if (found == NOT_FOUND && should_wrap)
+				found = find_next(game, kind, 0, current + 1);
+		}
+	}
+
+	if (found == NOT_FOUND)
+		return false;
+	minesweeper_set_cursor(game, found % game->width, found / game->width);
+	return true;
+}
+
+bool minesweeper_jump_cursor_in_direction(struct minesweeper_game *game, enum minesweeper_tile_kind kind, enum direction direction) {
+	size_t current, row_start, found = NOT_FOUND;
+	unsigned x, y;
+
+	if (game->selected_tile == NULL || kind >= MINESWEEPER_TILE_KIND_COUNT)
+		return false;
+	current = row_major_index(game, game->selected_tile);
+	x = current % game->width;
+	y = current / game->width;
+	row_start = current - x;
+
+	switch (direction) {
+	case LEFT:
+		if (x > 0)
+			found = find_previous(game, kind, current - 1, row_start);
+		break;
+	case RIGHT:
+		found = find_next(game, kind, current + 1, row_start + game->width);
+		break;
+	case UP:
+	case DOWN:
+		found = find_in_column(game, kind, x, y, direction == UP);
+		if (found != NOT_FOUND)
+			found = found * game->width + x;
+		break;
+	}
+
+	if (found == NOT_FOUND)
+		return false;
+	minesweeper_set_cursor(game, found % game->width, found / game->width);
+	return true;
+}
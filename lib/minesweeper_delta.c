@@ -0,0 +1,210 @@
+#include <minesweeper_delta.h>
+#include <string.h>
+#include "minesweeper_internal.h"
+
+static inline uint8_t visible_value(const struct minesweeper_tile *tile) {
+	if (tile->is_opened)
+		return tile->has_mine ? MINESWEEPER_DELTA_OPENED_MINE : tile->adjacent_mine_count;
+	return tile->has_flag ? MINESWEEPER_DELTA_FLAGGED : MINESWEEPER_DELTA_HIDDEN;
+}
+
+static inline void apply_visible_value(struct minesweeper_tile *tile, uint8_t value) {
+	tile->is_opened = value <= MINESWEEPER_DELTA_OPENED_MINE;
+	tile->has_mine = value == MINESWEEPER_DELTA_OPENED_MINE;
+	tile->has_flag = value == MINESWEEPER_DELTA_FLAGGED;
+	tile->adjacent_mine_count = value < MINESWEEPER_DELTA_OPENED_MINE ? value : 0;
+}
+
+static uint8_t *write_u32(uint8_t *out, uint32_t value) {
+	out[0] = value & 0xFF;
+	out[1] = (value >> 8) & 0xFF;
+	out[2] = (value >> 16) & 0xFF;
+	out[3] = (value >> 24) & 0xFF;
+	return out + 4;
+}
+
+static uint32_t read_u32(const uint8_t *in) {
+	return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+static uint8_t *write_varint(uint8_t *out, uint32_t value) {
+	while (value >= 0x80) {
+		*out++ = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	*out++ = value;
+	return out;
+}
+
+static size_t varint_size(uint32_t value) {
+	size_t size = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+/**
+ * Returns a pointer past the varint, or NULL if it runs
+ * past end or doesn't fit in 32 bits.
+ */
+static const uint8_t *read_varint(const uint8_t *in, const uint8_t *end, uint32_t *value) {
+	unsigned shift;
+	*value = 0;
+	for (shift = 0; in < end && shift < 35; shift += 7) {
+		uint8_t byte = *in++;
+		/* Only the low 4 bits of the fifth byte fit */
+		if (shift == 28 && (byte & 0x70))
+			return NULL;
+		*value |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return in;
+	}
+	return NULL;
+}
+
+/**
+ * Write a run header followed by the packed values of
+ * tiles [start, start + length).
+ */
+static uint8_t *write_run(struct minesweeper_game *game, uint8_t *out, uint32_t gap, uint32_t start, uint32_t length) {
+	const struct minesweeper_tile *tile = &game->tiles[start];
+	const struct minesweeper_tile *end = tile + length;
+
+	out = write_varint(out, gap);
+	out = write_varint(out, length);
+	for (; tile + 1 < end; tile += 2) {
+		*out++ = visible_value(tile) | visible_value(tile + 1) << 4;
+	}
+	if (tile < end) {
+		*out++ = visible_value(tile);
+	}
+	return out;
+}
+
+size_t minesweeper_delta_max_size(struct minesweeper_game *game) {
+	size_t tile_count = (size_t)game->width * game->height;
+	size_t changed_count = game->change_tracker->changed_tile_count;
+	/* Runs are separated by at least one unchanged tile */
+	size_t run_count = changed_count < tile_count - changed_count + 1 ? changed_count : tile_count - changed_count + 1;
+	/* Each run has a gap and a length that are both below the tile count,
+	 * and an odd length wastes half a byte on its last value. */
+	return MINESWEEPER_DELTA_HEADER_SIZE
+		+ run_count * (varint_size(tile_count) + varint_size(changed_count))
+		+ (changed_count + run_count) / 2;
+}
+
+size_t minesweeper_delta_encode(struct minesweeper_game *game, uint32_t sequence, uint8_t *out, size_t out_size) {
+	struct minesweeper_change_tracker *tracker = game->change_tracker;
+	size_t summary_words = ((size_t)game->width * game->height + 1023) / 1024;
+	uint8_t *cursor = out;
+	uint8_t *run_count_location;
+	uint32_t run_count = 0;
+	uint32_t run_start = 0, run_end = 0; /* Current run, which is pending when non-empty */
+	uint32_t previous_end = 0;
+	size_t s;
+
+	if (out_size < minesweeper_delta_max_size(game))
+		return 0;
+
+	cursor = write_u32(cursor, sequence);
+	*cursor++ = game->state;
+	cursor = write_u32(cursor, game->mine_count);
+	cursor = write_u32(cursor, game->opened_tile_count);
+	cursor = write_u32(cursor, game->flag_count);
+	run_count_location = cursor;
+	cursor += 4;
+
+	for (s = 0; s < summary_words; s++) {
+		uint32_t summary = tracker->word_bits[s];
+		tracker->word_bits[s] = 0;
+		while (summary) {
+			uint32_t w = s * 32 + count_trailing_zeros(summary);
+			uint32_t bits = tracker->tile_bits[w];
+			summary &= summary - 1;
+			tracker->tile_bits[w] = 0;
+
+			/* Consume the word one stretch of consecutive set bits at a time */
+			while (bits) {
+				unsigned first = count_trailing_zeros(bits);
+				unsigned length = ~(bits >> first) ? count_trailing_zeros(~(bits >> first)) : 32 - first;
+				uint32_t start = w * 32 + first;
+				if (start != run_end || run_start == run_end) {
+					if (run_start != run_end) {
+						cursor = write_run(game, cursor, run_start - previous_end, run_start, run_end - run_start);
+						previous_end = run_end;
+						run_count++;
+					}
+					run_start = start;
+				}
+				run_end = start + length;
+				bits = first + length < 32 ? bits & ~(uint32_t)0 << (first + length) : 0;
+			}
+		}
+	}
+
+	if (run_start != run_end) {
+		cursor = write_run(game, cursor, run_start - previous_end, run_start, run_end - run_start);
+		run_count++;
+	}
+
+	write_u32(run_count_location, run_count);
+	tracker->changed_tile_count = 0;
+	return cursor - out;
+}
+
+bool minesweeper_delta_decode(struct minesweeper_game *mirror, const uint8_t *data, size_t size, uint32_t *sequence) {
+	const uint8_t *end = data + size;
+	uint32_t tile_count = mirror->width * mirror->height;
+	uint32_t position = 0;
+	uint32_t run_count, r;
+
+	/* Labels depend on where the mines are, which a mirror doesn't know */
+	if (size < MINESWEEPER_DELTA_HEADER_SIZE || mirror->zero_region_labels != NULL)
+		return false;
+
+	if (data[4] > MINESWEEPER_GAME_OVER)
+		return false;
+
+	if (sequence != NULL)
+		*sequence = read_u32(data);
+	mirror->state = (enum minesweeper_game_state)data[4];
+	mirror->mine_count = read_u32(data + 5);
+	mirror->opened_tile_count = read_u32(data + 9);
+	mirror->flag_count = read_u32(data + 13);
+	run_count = read_u32(data + 17);
+	data += MINESWEEPER_DELTA_HEADER_SIZE;
+
+	for (r = 0; r < run_count; r++) {
+		uint32_t gap, length, i;
+		unsigned x, y;
+		if (!(data = read_varint(data, end, &gap)) || !(data = read_varint(data, end, &length)))
+			return false;
+		if (gap > tile_count - position || length > tile_count - position - gap || (size_t)(end - data) < (length + 1) / 2)
+			return false;
+
+		position += gap;
+		x = position % mirror->width;
+		y = position / mirror->width;
+		for (i = 0; i < length; i++) {
+			uint8_t value = (data[i / 2] >> (i % 2 * 4)) & 0x0F;
+			struct minesweeper_tile *tile = &mirror->tiles[tile_index(mirror, x, y)], before = *tile;
+			if (value > MINESWEEPER_DELTA_HIDDEN)
+				return false;
+			before_tile_change(mirror, tile_index(mirror, x, y));
+			apply_visible_value(tile, value);
+			if (mirror->adjacent_flag_counts != NULL && before.has_flag != tile->has_flag)
+				update_adjacent_flag_counts(mirror, tile);
+			rehash_tile(mirror, (size_t)y * mirror->width + x, &before, tile);
+			update_tile_indices(mirror, (size_t)y * mirror->width + x, tile);
+			if (++x == mirror->width) {
+				x = 0;
+				y++;
+			}
+		}
+		data += (length + 1) / 2;
+		position += length;
+	}
+	return true;
+}
@@ -0,0 +1,311 @@
+#include <minesweeper_hint.h>
+#include <string.h>
+#include "minesweeper_internal.h"
+
+/**
+ * Every opened tile with adjacent mines is a constraint on its unopened
+ * neighbours. When the mines already known around it account for all of
+ * its adjacent mines, the other neighbours are safe. When its unknown
+ * neighbours are exactly as many as its remaining mines, they're all
+ * mines. Each new fact can in turn settle the constraints of the opened
+ * tiles around it, so those are pushed to the pending list to be checked
+ * again. Facts never stop being true as more tiles are opened, so they're
+ * kept until tiles change in another way, such as being closed again by
+ * a rollback, and the cache then starts over.
+ *
+ * When nothing is certain, the local mine probability of every unknown
+ * tile is kept as well. It only depends on the opened tiles next to it
+ * and their neighbours, so a tile's probability is only computed again
+ * when a tile within two steps of it changes.
+ */
+
+#define KNOWN_SAFE (1 << 0) /* Opened, or deduced to be safe */
+#define KNOWN_MINE (1 << 1)
+#define IS_PENDING (1 << 2) /* In the pending list */
+#define SEEN_OPENED (1 << 3) /* Known to the cache to be opened */
+#define GUESS_OUTDATED (1 << 4) /* In the outdated guess list */
+
+struct minesweeper_hint_cache *minesweeper_cache_hints(struct minesweeper_game *game, uint8_t *buffer) {
+	size_t tile_count = (size_t)game->width * game->height;
+	struct minesweeper_hint_cache *cache = (struct minesweeper_hint_cache *)buffer;
+	cache->pending = (uint32_t *)(buffer + sizeof(struct minesweeper_hint_cache));
+	cache->safe_tiles = cache->pending + tile_count;
+	cache->outdated_guesses = cache->safe_tiles + tile_count;
+	cache->guess_probabilities = (float *)(cache->outdated_guesses + tile_count);
+	cache->tile_states = (uint8_t *)(cache->guess_probabilities + tile_count);
+	cache->is_outdated = true;
+	cache->has_hint = false;
+	game->hint_cache = cache;
+	return cache;
+}
+
+size_t minesweeper_hint_cache_buffer_size(unsigned width, unsigned height) {
+	size_t tile_count = (size_t)width * height;
+	return sizeof(struct minesweeper_hint_cache) + (sizeof(uint32_t) * 3 + sizeof(float) + 1) * tile_count;
+}
+
+static inline const struct minesweeper_tile *tile_at(const struct minesweeper_game *game, size_t index) {
+	return &game->tiles[tile_index(game, index % game->width, index / game->width)];
+}
+
+static void mark_pending(struct minesweeper_hint_cache *cache, size_t index) {
+	if (cache->tile_states[index] & IS_PENDING)
+		return;
+	cache->tile_states[index] |= IS_PENDING;
+	cache->pending[cache->pending_count++] = index;
+}
+
+static void mark_adjacent_pending(struct minesweeper_game *game, size_t index) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	size_t adjacent[8];
+	unsigned count = adjacent_indices(game, index, adjacent), i;
+	for (i = 0; i < count; i++) {
+		if (cache->tile_states[adjacent[i]] & SEEN_OPENED)
+			mark_pending(cache, adjacent[i]);
+	}
+}
+
+static void mark_guess_outdated(struct minesweeper_hint_cache *cache, size_t index) {
+	if (cache->tile_states[index] & GUESS_OUTDATED)
+		return;
+	cache->tile_states[index] |= GUESS_OUTDATED;
+	cache->outdated_guesses[cache->outdated_guess_count++] = index;
+}
+
+/**
+ * Marks the guesses that depend on a tile as outdated, which are
+ * the neighbours of the tile and of each of its neighbours.
+ */
+static void mark_nearby_guesses_outdated(struct minesweeper_game *game, size_t index) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	size_t adjacent[8], nearby[8];
+	unsigned adjacent_count = adjacent_indices(game, index, adjacent), nearby_count, i, j;
+
+	for (i = 0; i < adjacent_count; i++) {
+		mark_guess_outdated(cache, adjacent[i]);
+		nearby_count = adjacent_indices(game, adjacent[i], nearby);
+		for (j = 0; j < nearby_count; j++) {
+			mark_guess_outdated(cache, nearby[j]);
+		}
+	}
+}
+
+void hint_tile_changed(struct minesweeper_game *game, size_t index, const struct minesweeper_tile *tile) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	uint8_t *state = &cache->tile_states[index];
+
+	if (cache->has_hint && (!cache->hint.is_safe || index == (size_t)cache->hint.y * game->width + cache->hint.x))
+		cache->has_hint = false;
+	if (cache->is_outdated)
+		return;
+	if ((*state & SEEN_OPENED) && !tile->is_opened) {
+		outdate_hints(game);
+		return;
+	}
+	if (!tile->is_opened || (*state & SEEN_OPENED))
+		return;
+	if (tile->has_mine || (*state & KNOWN_MINE)) {
+		outdate_hints(game);
+		return;
+	}
+	*state |= SEEN_OPENED | KNOWN_SAFE;
+	if (tile->adjacent_mine_count > 0)
+		mark_pending(cache, index);
+	mark_adjacent_pending(game, index);
+	mark_nearby_guesses_outdated(game, index);
+}
+
+static void rebuild(struct minesweeper_game *game) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	size_t tile_count = (size_t)game->width * game->height, i;
+
+	memset(cache->tile_states, GUESS_OUTDATED, tile_count);
+	cache->pending_count = 0;
+	cache->outdated_guess_count = tile_count;
+	cache->safe_tile_count = 0;
+	cache->known_mine_count = 0;
+	for (i = 0; i < tile_count; i++) {
+		const struct minesweeper_tile *tile = tile_at(game, i);
+		cache->outdated_guesses[i] = i;
+		if (!tile->is_opened || tile->has_mine)
+			continue;
+		cache->tile_states[i] |= SEEN_OPENED | KNOWN_SAFE;
+		if (tile->adjacent_mine_count > 0)
+			mark_pending(cache, i);
+	}
+	cache->is_outdated = false;
+}
+
+/**
+ * Checks the constraint of an opened tile, marking its unknown
+ * neighbours as safe or as mines if that's the only possibility.
+ */
+static void check_constraint(struct minesweeper_game *game, size_t index) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	unsigned mine_count = tile_at(game, index)->adjacent_mine_count;
+	size_t adjacent[8], unknown[8];
+	unsigned adjacent_count = adjacent_indices(game, index, adjacent);
+	unsigned known_mine_count = 0, unknown_count = 0, i;
+	bool are_mines;
+
+	for (i = 0; i < adjacent_count; i++) {
+		uint8_t state = cache->tile_states[adjacent[i]];
+		if (state & KNOWN_MINE)
+			known_mine_count++;
+		else if (!(state & KNOWN_SAFE))
+			unknown[unknown_count++] = adjacent[i];
+	}
+	if (unknown_count == 0 || (known_mine_count != mine_count && known_mine_count + unknown_count != mine_count))
+		return;
+
+	are_mines = known_mine_count != mine_count;
+	for (i = 0; i < unknown_count; i++) {
+		uint8_t *state = &cache->tile_states[unknown[i]];
+		if (are_mines) {
+			*state |= KNOWN_MINE;
+			cache->known_mine_count++;
+		} else {
+			*state |= KNOWN_SAFE;
+			cache->safe_tiles[cache->safe_tile_count++] = unknown[i];
+		}
+		mark_adjacent_pending(game, unknown[i]);
+		mark_nearby_guesses_outdated(game, unknown[i]);
+	}
+}
+
+/**
+ * Finds a safe tile in the safe list that can be opened,
+ * dropping tiles that have been opened since.
+ */
+static bool find_safe_tile(struct minesweeper_game *game, size_t *index) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	size_t i = 0;
+	while (i < cache->safe_tile_count) {
+		const struct minesweeper_tile *tile = tile_at(game, cache->safe_tiles[i]);
+		if (tile->is_opened) {
+			cache->safe_tiles[i] = cache->safe_tiles[--cache->safe_tile_count];
+			continue;
+		}
+		if (!tile->has_flag) {
+			*index = cache->safe_tiles[i];
+			return true;
+		}
+		i++;
+	}
+	return false;
+}
+
+/**
+ * Estimates the chance of a mine on an unknown tile from the most
+ * constraining of its opened neighbours. Returns a negative value
+ * for tiles without opened neighbours.
+ */
+static float local_mine_probability(struct minesweeper_game *game, size_t index) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	size_t adjacent[8], constraint[8];
+	unsigned adjacent_count = adjacent_indices(game, index, adjacent);
+	unsigned i, j;
+	float probability = -1;
+
+	for (i = 0; i < adjacent_count; i++) {
+		unsigned constraint_count, unknown_count = 0;
+		int remaining_mines;
+		if (!(cache->tile_states[adjacent[i]] & SEEN_OPENED))
+			continue;
+		remaining_mines = tile_at(game, adjacent[i])->adjacent_mine_count;
+		constraint_count = adjacent_indices(game, adjacent[i], constraint);
+		for (j = 0; j < constraint_count; j++) {
+			uint8_t state = cache->tile_states[constraint[j]];
+			if (state & KNOWN_MINE)
+				remaining_mines--;
+			else if (!(state & KNOWN_SAFE))
+				unknown_count++;
+		}
+		if ((float)remaining_mines / unknown_count > probability)
+			probability = (float)remaining_mines / unknown_count;
+	}
+	return probability;
+}
+
+/**
+ * Finds the unknown tile least likely to have a mine. Tiles away from
+ * any opened tile share the mines that aren't known yet evenly.
+ */
+static bool find_best_guess(struct minesweeper_game *game, size_t *index, float *mine_probability) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	size_t tile_count = (size_t)game->width * game->height, i;
+	size_t unknown_count = 0, best_index = 0, interior_index = 0;
+	float best_probability = 2;
+	bool has_interior = false;
+
+	while (cache->outdated_guess_count > 0) {
+		i = cache->outdated_guesses[--cache->outdated_guess_count];
+		cache->tile_states[i] &= ~GUESS_OUTDATED;
+		if (!(cache->tile_states[i] & (KNOWN_SAFE | KNOWN_MINE)))
+			cache->guess_probabilities[i] = local_mine_probability(game, i);
+	}
+
+	for (i = 0; i < tile_count; i++) {
+		float probability;
+		if (cache->tile_states[i] & (KNOWN_SAFE | KNOWN_MINE))
+			continue;
+		unknown_count++;
+		if (tile_at(game, i)->has_flag)
+			continue;
+		probability = cache->guess_probabilities[i];
+		if (probability < 0) {
+			if (!has_interior)
+				interior_index = i;
+			has_interior = true;
+		} else if (probability < best_probability) {
+			best_probability = probability;
+			best_index = i;
+		}
+	}
+
+	if (has_interior) {
+		float density = (float)(game->mine_count - cache->known_mine_count) / unknown_count;
+		if (density < best_probability) {
+			best_probability = density;
+			best_index = interior_index;
+		}
+	}
+	*index = best_index;
+	*mine_probability = best_probability;
+	return best_probability <= 1;
+}
+
+bool minesweeper_get_hint(struct minesweeper_game *game, struct minesweeper_hint *hint) {
+	struct minesweeper_hint_cache *cache = game->hint_cache;
+	size_t index;
+	float mine_probability = 0;
+
+	if (game->state == MINESWEEPER_GAME_OVER || game->state == MINESWEEPER_WIN)
+		return false;
+	if (cache->has_hint) {
+		*hint = cache->hint;
+		return true;
+	}
+
+	if (cache->is_outdated)
+		rebuild(game);
+	while (cache->pending_count > 0) {
+		index = cache->pending[--cache->pending_count];
+		cache->tile_states[index] &= ~IS_PENDING;
+		check_constraint(game, index);
+	}
+
+	if (!find_safe_tile(game, &index) && !find_best_guess(game, &index, &mine_probability))
+		return false;
+	/* The first tile opened never has a mine */
+	if (game->state == MINESWEEPER_PENDING_START)
+		mine_probability = 0;
+
+	cache->hint.x = index % game->width;
+	cache->hint.y = index / game->width;
+	cache->hint.is_safe = mine_probability == 0;
+	cache->hint.mine_probability = mine_probability;
+	cache->has_hint = true;
+	*hint = cache->hint;
+	return true;
+}
@@ -0,0 +1,344 @@
+#ifndef MINESWEEPER_INTERNAL_H
+#define MINESWEEPER_INTERNAL_H
+
+/* Helpers shared between the library's implementation files. Not part of the public API. */
+
+#include <limits.h>
+#include <minesweeper.h>
+#include <minesweeper_checkpoint.h>
+#include <minesweeper_batch.h>
+#include <minesweeper_hint.h>
+
+/**
+ * Whether a tile is safe and has no adjacent mines, so that opening it
+ * opens its adjacent tiles too.
+ */
+static inline bool is_zero_tile(const struct minesweeper_tile *tile) {
+	return !tile->has_mine && tile->adjacent_mine_count == 0;
+}
+
+/**
+ * Index into game->tiles for an in-bounds location.
+ */
+static inline size_t tile_index(const struct minesweeper_game *game, unsigned x, unsigned y) {
+	return (size_t)y * game->width + x;
+}
+
+static inline void tile_index_location(const struct minesweeper_game *game, size_t index, unsigned *x, unsigned *y) {
+	*y = index / game->width;
+	*x = index % game->width;
+}
+
+/**
+ * Position of a tile in row-major order (y * width + x), which is
+ * also its index in game->tiles.
+ */
+static inline size_t row_major_index(const struct minesweeper_game *game, const struct minesweeper_tile *tile) {
+	return tile - game->tiles;
+}
+
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+/**
+ * Which tiles are adjacent is decided by the topology. Functions that
+ * visit adjacent tiles take it as a parameter and are always inlined
+ * with a constant, so each topology gets its own specialized copy, and
+ * the topology is only checked once per call instead of per tile.
+ */
+enum topology {
+	BOUNDED = 0,
+	TORUS = 1 << 0,
+	HEX = 1 << 1,
+	HEX_TORUS = TORUS | HEX
+};
+
+static inline enum topology game_topology(const struct minesweeper_game *game) {
+	return (enum topology)(((game->options & MINESWEEPER_TORUS) ? TORUS : 0) | ((game->options & MINESWEEPER_HEX) ? HEX : 0));
+}
+
+/**
+ * Calls function(game, topology, ...) with the topology of game as a
+ * constant, so that a specialized copy of function is used.
+ */
+#define DISPATCH_TOPOLOGY(function, game, ...) \
+	do { \
+		switch (game_topology(game)) { \
+		case BOUNDED: function(game, BOUNDED, __VA_ARGS__); break; \
+		case TORUS: function(game, TORUS, __VA_ARGS__); break; \
+		case HEX: function(game, HEX, __VA_ARGS__); break; \
+		case HEX_TORUS: function(game, HEX_TORUS, __VA_ARGS__); break; \
+		} \
+	} while (0)
+
+/**
+ * A run of tiles on a row, from min_x to max_x.
+ */
+struct span {
+	unsigned y, min_x, max_x;
+};
+
+#define MAX_ADJACENT_SPANS 6
+
+/**
+ * Adds the span of tiles from min_x to max_x on row y, where min_x may be
+ * -1 and max_x may be width, which means wrapping around on a torus and
+ * leaving out that tile otherwise. Returns the new number of spans.
+ */
+static ALWAYS_INLINE unsigned add_span(const struct minesweeper_game *game, enum topology topology, struct span *spans, unsigned count, long min_x, long max_x, unsigned y) {
+	long width = game->width;
+	if (!(topology & TORUS)) {
+		if (min_x < 0)
+			min_x = 0;
+		if (max_x >= width)
+			max_x = width - 1;
+	} else if (max_x - min_x + 1 >= width) {
+		min_x = 0;
+		max_x = width - 1;
+	} else if (min_x < 0 || max_x >= width) {
+		/* Split off the tile on the other side */
+		spans[count].y = y;
+		spans[count].min_x = spans[count].max_x = min_x < 0 ? width - 1 : 0;
+		count++;
+		if (min_x < 0)
+			min_x = 0;
+		else
+			max_x = width - 1;
+	}
+	spans[count].y = y;
+	spans[count].min_x = min_x;
+	spans[count].max_x = max_x;
+	return count + 1;
+}
+
+/**
+ * Finds the tiles adjacent to any tile in the run from x1 to x2 on row
+ * y, as at most MAX_ADJACENT_SPANS spans. The run itself is included.
+ * Returns the number of spans.
+ */
+static ALWAYS_INLINE unsigned adjacent_spans(const struct minesweeper_game *game, enum topology topology, unsigned x1, unsigned x2, unsigned y, struct span spans[MAX_ADJACENT_SPANS]) {
+	/* Hexagonal rows above and below reach one tile less to one side */
+	long min_x = (long)x1 - 1, max_x = (long)x2 + 1;
+	long other_min_x = (topology & HEX) && (y & 1) ? (long)x1 : min_x;
+	long other_max_x = (topology & HEX) && !(y & 1) ? (long)x2 : max_x;
+	unsigned count = 0;
+
+	if (y > 0)
+		count = add_span(game, topology, spans, count, other_min_x, other_max_x, y - 1);
+	else if (topology & TORUS)
+		count = add_span(game, topology, spans, count, other_min_x, other_max_x, game->height - 1);
+	count = add_span(game, topology, spans, count, min_x, max_x, y);
+	if (y + 1 < game->height)
+		count = add_span(game, topology, spans, count, other_min_x, other_max_x, y + 1);
+	else if (topology & TORUS)
+		count = add_span(game, topology, spans, count, other_min_x, other_max_x, 0);
+	return count;
+}
+
+/**
+ * Gets the row-major indices of the tiles adjacent to a row-major index,
+ * following the topology of game. Returns the number of adjacent tiles.
+ */
+unsigned adjacent_indices(const struct minesweeper_game *game, size_t index, size_t adjacent[8]);
+
+#define UNLIMITED_TILES UINT_MAX
+
+void cascade_init(struct minesweeper_cascade *cascade);
+
+/**
+ * Opens the tiles adjacent to pending tiles until none are left, or until
+ * about max_tiles tiles have been opened or checked. Returns true if none
+ * are left.
+ */
+bool run_cascade(struct minesweeper_game *game, struct minesweeper_cascade *cascade, unsigned max_tiles);
+
+/**
+ * Opens an unopened tile, or quick-opens the tiles adjacent to an
+ * opened one, marking tiles pending in cascade without running it.
+ */
+void _open_tile(struct minesweeper_game *game, struct minesweeper_tile *tile, struct minesweeper_cascade *cascade);
+
+/**
+ * Moves the game from MINESWEEPER_PENDING_START to MINESWEEPER_PLAYING
+ * when first_tile is the first tile to be opened.
+ */
+void start_game(struct minesweeper_game *game, struct minesweeper_tile *first_tile);
+
+/**
+ * Reports a changed tile to the change tracker, update queue and indices
+ * of a game. send_update_callback() also calls tile_update_callback.
+ * Counters and the game state must already be updated.
+ */
+void record_tile_update(struct minesweeper_game *game, struct minesweeper_tile *tile);
+void send_update_callback(struct minesweeper_game *game, struct minesweeper_tile *tile);
+
+/**
+ * Adjusts game->adjacent_flag_counts around a tile whose flag was just toggled.
+ */
+void update_adjacent_flag_counts(struct minesweeper_game *game, struct minesweeper_tile *tile);
+uint8_t count_adjacent_flags(struct minesweeper_game *game, struct minesweeper_tile *tile);
+void mark_tile_changed(struct minesweeper_change_tracker *tracker, size_t index);
+bool all_tiles_opened(struct minesweeper_game *game);
+
+static inline bool is_page_saved(const struct minesweeper_checkpoint *checkpoint, size_t page) {
+	return (checkpoint->saved_page_bits[page / 32] >> (page % 32)) & 1;
+}
+
+void save_checkpoint_page(struct minesweeper_game *game, size_t page);
+
+/**
+ * Must be called before modifying game->tiles[index] or its adjacent
+ * flag count, so that the newest checkpoint can restore it.
+ */
+static inline void before_tile_change(struct minesweeper_game *game, size_t index) {
+	size_t page = index / MINESWEEPER_CHECKPOINT_PAGE_SIZE;
+	if (game->checkpoint != NULL && !is_page_saved(game->checkpoint, page) && !game->checkpoint->overflowed)
+		save_checkpoint_page(game, page);
+}
+
+/**
+ * Returns MINESWEEPER_ACTION_NO_CHANGE for an action
+ * that apply_action() can apply without further checks.
+ */
+enum minesweeper_action_result validate_action(const struct minesweeper_game *game, const struct minesweeper_action *action);
+void apply_action(struct minesweeper_game *game, const struct minesweeper_action *action);
+
+/* Keeping game->hint_cache, game->cursor_index and game->overview up to date,
+ * see minesweeper_hint.c, minesweeper_cursor.c and minesweeper_overview.c */
+void hint_tile_changed(struct minesweeper_game *game, size_t index, const struct minesweeper_tile *tile);
+void cursor_index_tile_changed(struct minesweeper_game *game, size_t index, const struct minesweeper_tile *tile);
+void overview_tile_changed(struct minesweeper_game *game, size_t index);
+
+/**
+ * Must be called after a tile is opened, closed or flagged, along
+ * with the callbacks. index is the row-major index of the tile.
+ */
+static inline void update_tile_indices(struct minesweeper_game *game, size_t index, const struct minesweeper_tile *tile) {
+	if (game->hint_cache != NULL)
+		hint_tile_changed(game, index, tile);
+	if (game->cursor_index != NULL)
+		cursor_index_tile_changed(game, index, tile);
+	if (game->overview != NULL)
+		overview_tile_changed(game, index);
+}
+
+static inline void outdate_hints(struct minesweeper_game *game) {
+	if (game->hint_cache != NULL) {
+		game->hint_cache->is_outdated = true;
+		game->hint_cache->has_hint = false;
+	}
+}
+
+/**
+ * Runs function for each of count workers of worker_size bytes, on one
+ * thread each. The first worker runs on the calling thread, as does any
+ * worker that a thread couldn't be created for. Returns once all are
+ * done. See minesweeper_parallel.c, which requires POSIX threads.
+ */
+void run_workers(void *workers, size_t worker_size, unsigned count, void *(*function)(void *));
+
+/* Pushing to game->update_queue, see minesweeper_queue.c */
+void queue_tile_update(struct minesweeper_update_queue *queue, size_t index, const struct minesweeper_tile *tile);
+
+/* Zero region labelling, see minesweeper_regions.c */
+static inline unsigned zero_region_capacity(unsigned width, unsigned height) {
+	size_t capacity = (size_t)width * height / MINESWEEPER_MIN_LABELLED_REGION_SIZE;
+	return capacity < MINESWEEPER_MAX_ZERO_REGIONS ? capacity : MINESWEEPER_MAX_ZERO_REGIONS;
+}
+
+void label_zero_regions(struct minesweeper_game *game);
+void update_zero_region_flag_counts(struct minesweeper_game *game, struct minesweeper_tile *tile);
+void mark_zero_region_opened(struct minesweeper_game *game, unsigned x, unsigned y);
+
+/**
+ * Opens the labelled region containing the just opened zero tile at
+ * (x, y), along with its border. Returns false if the tile isn't in a
+ * labelled region, or if the region must be cascaded normally because
+ * it's partially opened or flagged.
+ */
+bool open_zero_region(struct minesweeper_game *game, unsigned x, unsigned y);
+
+/**
+ * Mixes the bits of a 32 bit value, so that every input
+ * bit affects every output bit (Chris Wellons' lowbias32).
+ */
+static inline uint32_t hash_32(uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x7FEB352D;
+	x ^= x >> 15;
+	x *= 0x846CA68B;
+	x ^= x >> 16;
+	return x;
+}
+
+/**
+ * Mixes the bits of a 64 bit value (the splitmix64 finalizer).
+ */
+static inline uint64_t hash_64(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EB;
+	x ^= x >> 31;
+	return x;
+}
+
+/**
+ * Zobrist keys are derived from the row-major index of a tile and a
+ * feature, instead of being stored in a table of random values. A hash
+ * is the XOR of the keys of all features present on the board, so a
+ * feature is added or removed by XORing its key.
+ */
+enum zobrist_feature {
+	ZOBRIST_MINE,
+	ZOBRIST_OPENED,
+	ZOBRIST_FLAG
+};
+
+static inline uint64_t zobrist_key(size_t index, enum zobrist_feature feature) {
+	return hash_64(((uint64_t)index << 2 | feature) + 0x9E3779B97F4A7C15);
+}
+
+/**
+ * Updates the hashes of game after a tile at a row-major index changed
+ * from before to after, in any way.
+ */
+static inline void rehash_tile(struct minesweeper_game *game, size_t index, const struct minesweeper_tile *before, const struct minesweeper_tile *after) {
+	if (before->has_mine != after->has_mine)
+		game->mine_hash ^= zobrist_key(index, ZOBRIST_MINE);
+	if (before->is_opened != after->is_opened)
+		game->visible_hash ^= zobrist_key(index, ZOBRIST_OPENED);
+	if (before->has_flag != after->has_flag)
+		game->visible_hash ^= zobrist_key(index, ZOBRIST_FLAG);
+}
+
+static inline unsigned count_trailing_zeros(uint32_t word) {
+#if defined(__GNUC__)
+	return __builtin_ctz(word);
+#else
+	unsigned count = 0;
+	while (!(word & 1)) {
+		word >>= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+static inline unsigned count_leading_zeros(uint32_t word) {
+#if defined(__GNUC__)
+	return __builtin_clz(word);
+#else
+	unsigned count = 0;
+	while (!(word & 0x80000000)) {
+		word <<= 1;
+		count++;
+	}
+	return count;
+#endif
+}
+
+#endif
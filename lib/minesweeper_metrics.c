@@ -0,0 +1,130 @@
+#include <minesweeper_metrics.h>
+#include "minesweeper_internal.h"
+
+/**
+ * Openings are counted as the number of zero tiles minus the number of
+ * joins that connect two separate sets. Union-find only needs the tiles
+ * of the previous and the current row, in two alternating halves of the
+ * buffer. A new tile always becomes the root when joining, so that every
+ * set that reaches the current row has its root there. Compressing the
+ * paths of the current row at its end then leaves nothing that points
+ * into the previous row, which can be overwritten by the next one.
+ *
+ * Isolated numbers are found the same way, a row behind. Each number
+ * starts out isolated unless an earlier neighbour is a zero tile, and
+ * zero tiles clear the later neighbours they're reached from.
+ */
+
+#define NOT_ZERO UINT32_MAX
+
+static uint32_t find_root(uint32_t *parents, uint32_t i) {
+	uint32_t root = i, next;
+	while (parents[root] != root)
+		root = parents[root];
+	while (i != root) {
+		next = parents[i];
+		parents[i] = root;
+		i = next;
+	}
+	return root;
+}
+
+/**
+ * Joins the set of slot b to that of the new tile in slot a.
+ * Returns true if they were separate sets.
+ */
+static inline bool join(uint32_t *parents, uint32_t a, uint32_t b) {
+	uint32_t root_a = find_root(parents, a), root_b = find_root(parents, b);
+	if (root_a == root_b)
+		return false;
+	parents[root_b] = root_a;
+	return true;
+}
+
+static unsigned count_isolated_numbers(const uint8_t *is_isolated, unsigned width) {
+	unsigned count = 0, x;
+	for (x = 0; x < width; x++) {
+		count += is_isolated[x];
+	}
+	return count;
+}
+
+bool minesweeper_compute_metrics(const struct minesweeper_game *game, struct minesweeper_metrics *metrics, uint8_t *buffer) {
+	uint32_t *parents = (uint32_t *)buffer;
+	uint8_t *is_isolated = buffer + sizeof(uint32_t) * 2 * game->width; /* Two alternating rows, like parents */
+	unsigned width = game->width;
+	unsigned zero_tile_count = 0, join_count = 0, isolated_number_count = 0;
+	unsigned x, y;
+
+	/* Wrapping rows and hexagonal neighbours would need other joins */
+	if (game_topology(game) != BOUNDED)
+		return false;
+
+	for (y = 0; y < game->height; y++) {
+		uint32_t row_start = (y & 1) * width, previous_row_start = (~y & 1) * width;
+		uint32_t *row = parents + row_start, *previous_row = parents + previous_row_start;
+		uint8_t *isolated_row = is_isolated + row_start, *isolated_previous_row = is_isolated + previous_row_start;
+		unsigned min_x, max_x, ax;
+
+		for (x = 0; x < width; x++) {
+			const struct minesweeper_tile *tile = &game->tiles[tile_index(game, x, y)];
+			min_x = x > 0 ? x - 1 : 0;
+			max_x = x + 1 < width ? x + 1 : x;
+
+			if (!is_zero_tile(tile)) {
+				row[x] = NOT_ZERO;
+				/* Zero tiles later in the row or below clear this when they're reached */
+				isolated_row[x] = !tile->has_mine && (x == 0 || row[x - 1] == NOT_ZERO);
+				for (ax = min_x; y > 0 && ax <= max_x && isolated_row[x]; ax++) {
+					isolated_row[x] = previous_row[ax] == NOT_ZERO;
+				}
+				continue;
+			}
+
+			zero_tile_count++;
+			row[x] = row_start + x;
+			isolated_row[x] = false;
+			if (x > 0)
+				isolated_row[x - 1] = false;
+			if (y > 0) {
+				for (ax = min_x; ax <= max_x; ax++) {
+					isolated_previous_row[ax] = false;
+				}
+			}
+
+			/* The tile above is adjacent to all other earlier neighbours,
+			 * so when it's a zero tile, they're already joined to it */
+			if (y > 0 && previous_row[x] != NOT_ZERO) {
+				join_count += join(parents, row_start + x, previous_row_start + x);
+				continue;
+			}
+			if (x > 0 && row[x - 1] != NOT_ZERO)
+				join_count += join(parents, row_start + x, row_start + x - 1);
+			if (y == 0)
+				continue;
+			if (x > 0 && previous_row[x - 1] != NOT_ZERO)
+				join_count += join(parents, row_start + x, previous_row_start + x - 1);
+			if (x + 1 < width && previous_row[x + 1] != NOT_ZERO)
+				join_count += join(parents, row_start + x, previous_row_start + x + 1);
+		}
+
+		for (x = 0; x < width; x++) {
+			if (row[x] != NOT_ZERO)
+				row[x] = find_root(parents, row_start + x);
+		}
+		/* Every tile adjacent to the previous row has now been seen */
+		if (y > 0)
+			isolated_number_count += count_isolated_numbers(isolated_previous_row, width);
+	}
+	if (game->height > 0)
+		isolated_number_count += count_isolated_numbers(is_isolated + ((game->height - 1) & 1) * width, width);
+
+	metrics->openings = zero_tile_count - join_count;
+	metrics->isolated_numbers = isolated_number_count;
+	metrics->bbbv = metrics->openings + isolated_number_count;
+	return true;
+}
+
+size_t minesweeper_metrics_buffer_size(unsigned width) {
+	return (sizeof(uint32_t) + 1) * 2 * (size_t)width;
+}
@@ -0,0 +1,64 @@
+#include <minesweeper_metrics.h>
+#include <stdlib.h>
+#include "minesweeper_internal.h"
+
+struct metrics_worker {
+	struct minesweeper_game *const *games;
+	struct minesweeper_metrics *metrics;
+	size_t first, end;
+	uint8_t *buffer;
+};
+
+static void *compute_metrics_range(void *context) {
+	struct metrics_worker *worker = context;
+	size_t i;
+	for (i = worker->first; i < worker->end; i++) {
+		minesweeper_compute_metrics(worker->games[i], &worker->metrics[i], worker->buffer);
+	}
+	return NULL;
+}
+
+bool minesweeper_compute_metrics_parallel(struct minesweeper_game *const *games, size_t count, struct minesweeper_metrics *metrics, unsigned thread_count) {
+	struct metrics_worker *workers;
+	unsigned max_width = 0;
+	unsigned i;
+	bool allocated = true;
+
+	if (count == 0)
+		return true;
+	if (thread_count == 0)
+		thread_count = 1;
+	if (thread_count > count)
+		thread_count = count;
+	for (i = 0; i < count; i++) {
+		if (games[i]->options & MINESWEEPER_TOPOLOGY_OPTIONS)
+			return false;
+		if (games[i]->width > max_width)
+			max_width = games[i]->width;
+	}
+
+	workers = calloc(thread_count, sizeof(struct metrics_worker));
+	for (i = 0; workers != NULL && i < thread_count; i++) {
+		workers[i].games = games;
+		workers[i].metrics = metrics;
+		workers[i].first = count * i / thread_count;
+		workers[i].end = count * (i + 1) / thread_count;
+		workers[i].buffer = malloc(minesweeper_metrics_buffer_size(max_width));
+		allocated = allocated && workers[i].buffer != NULL;
+	}
+	if (workers == NULL || !allocated) {
+		for (i = 0; workers != NULL && i < thread_count; i++) {
+			free(workers[i].buffer);
+		}
+		free(workers);
+		return false;
+	}
+
+	run_workers(workers, sizeof(struct metrics_worker), thread_count, compute_metrics_range);
+
+	for (i = 0; i < thread_count; i++) {
+		free(workers[i].buffer);
+	}
+	free(workers);
+	return true;
+}
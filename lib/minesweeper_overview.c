@@ -0,0 +1,162 @@
+#include <minesweeper_overview.h>
+#include <string.h>
+#include "minesweeper_internal.h"
+
+/**
+ * Level 0 is counted from the tiles, one block at a time. Counts only
+ * ever change by adding the difference between the new and the old count
+ * of a block to each cell above it, so the levels above stay the sums of
+ * the cells below them without being counted again. Differences may be
+ * negative, which the unsigned counts handle by wrapping around.
+ */
+
+static unsigned level_count(unsigned width, unsigned height) {
+	unsigned count = 1;
+	width = (width + MINESWEEPER_OVERVIEW_BLOCK_SIZE - 1) >> MINESWEEPER_OVERVIEW_BLOCK_SHIFT;
+	height = (height + MINESWEEPER_OVERVIEW_BLOCK_SIZE - 1) >> MINESWEEPER_OVERVIEW_BLOCK_SHIFT;
+	while (width > 1 || height > 1) {
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		count++;
+	}
+	return count;
+}
+
+static inline unsigned level_size(unsigned tile_count, unsigned level) {
+	unsigned shift = MINESWEEPER_OVERVIEW_BLOCK_SHIFT + level;
+	return (unsigned)(((uint64_t)tile_count + ((uint64_t)1 << shift) - 1) >> shift);
+}
+
+size_t minesweeper_overview_buffer_size(unsigned width, unsigned height) {
+	size_t block_count = (size_t)level_size(width, 0) * level_size(height, 0);
+	size_t size = sizeof(struct minesweeper_overview) + sizeof(uint32_t) * ((block_count + 31) / 32 + block_count);
+	unsigned count = level_count(width, height), level;
+	for (level = 0; level < count; level++) {
+		size += sizeof(struct minesweeper_tile_counts) * level_size(width, level) * level_size(height, level);
+	}
+	return size;
+}
+
+/**
+ * Counts the tiles of a cell of level 0 from scratch.
+ */
+static struct minesweeper_tile_counts count_block(const struct minesweeper_game *game, unsigned block_x, unsigned block_y) {
+	unsigned min_x = block_x << MINESWEEPER_OVERVIEW_BLOCK_SHIFT, min_y = block_y << MINESWEEPER_OVERVIEW_BLOCK_SHIFT;
+	unsigned max_x = min_x + MINESWEEPER_OVERVIEW_BLOCK_SIZE < game->width ? min_x + MINESWEEPER_OVERVIEW_BLOCK_SIZE : game->width;
+	unsigned max_y = min_y + MINESWEEPER_OVERVIEW_BLOCK_SIZE < game->height ? min_y + MINESWEEPER_OVERVIEW_BLOCK_SIZE : game->height;
+	struct minesweeper_tile_counts counts = { 0, 0, 0 };
+	unsigned x, y;
+	for (y = min_y; y < max_y; y++) {
+		for (x = min_x; x < max_x; x++) {
+			const struct minesweeper_tile *tile = &game->tiles[tile_index(game, x, y)];
+			counts.opened += tile->is_opened;
+			counts.flagged += tile->has_flag;
+			counts.revealed_mines += tile->is_opened && tile->has_mine;
+		}
+	}
+	return counts;
+}
+
+static inline void add_counts(struct minesweeper_tile_counts *to, const struct minesweeper_tile_counts *counts) {
+	to->opened += counts->opened;
+	to->flagged += counts->flagged;
+	to->revealed_mines += counts->revealed_mines;
+}
+
+struct minesweeper_overview *minesweeper_track_overview(struct minesweeper_game *game, uint8_t *buffer) {
+	struct minesweeper_overview *overview = (struct minesweeper_overview *)buffer;
+	size_t block_count = (size_t)level_size(game->width, 0) * level_size(game->height, 0);
+	struct minesweeper_tile_counts *cells;
+	unsigned level, x, y;
+
+	overview->outdated_bits = (uint32_t *)(buffer + sizeof(struct minesweeper_overview));
+	overview->outdated_blocks = overview->outdated_bits + (block_count + 31) / 32;
+	overview->outdated_block_count = 0;
+	memset(overview->outdated_bits, 0, sizeof(uint32_t) * ((block_count + 31) / 32));
+
+	cells = (struct minesweeper_tile_counts *)(overview->outdated_blocks + block_count);
+	overview->level_count = level_count(game->width, game->height);
+	for (level = 0; level < overview->level_count; level++) {
+		overview->levels[level] = cells;
+		overview->level_widths[level] = level_size(game->width, level);
+		overview->level_heights[level] = level_size(game->height, level);
+		cells += overview->level_widths[level] * overview->level_heights[level];
+	}
+
+	for (y = 0; y < overview->level_heights[0]; y++) {
+		for (x = 0; x < overview->level_widths[0]; x++) {
+			overview->levels[0][y * overview->level_widths[0] + x] = count_block(game, x, y);
+		}
+	}
+	for (level = 1; level < overview->level_count; level++) {
+		unsigned below_width = overview->level_widths[level - 1];
+		memset(overview->levels[level], 0, sizeof(struct minesweeper_tile_counts) * overview->level_widths[level] * overview->level_heights[level]);
+		for (y = 0; y < overview->level_heights[level - 1]; y++) {
+			for (x = 0; x < below_width; x++) {
+				add_counts(&overview->levels[level][(y / 2) * overview->level_widths[level] + x / 2], &overview->levels[level - 1][y * below_width + x]);
+			}
+		}
+	}
+	game->overview = overview;
+	return overview;
+}
+
+void overview_tile_changed(struct minesweeper_game *game, size_t index) {
+	struct minesweeper_overview *overview = game->overview;
+	unsigned x = index % game->width, y = index / game->width;
+	uint32_t block = (y >> MINESWEEPER_OVERVIEW_BLOCK_SHIFT) * overview->level_widths[0] + (x >> MINESWEEPER_OVERVIEW_BLOCK_SHIFT);
+	uint32_t bit = (uint32_t)1 << (block % 32);
+	if (overview->outdated_bits[block / 32] & bit)
+		return;
+	overview->outdated_bits[block / 32] |= bit;
+	overview->outdated_blocks[overview->outdated_block_count++] = block;
+}
+
+/**
+ * Counts all outdated blocks again, and adds the differences to the levels above.
+ */
+static void update_outdated_blocks(struct minesweeper_game *game) {
+	struct minesweeper_overview *overview = game->overview;
+	size_t i;
+	for (i = 0; i < overview->outdated_block_count; i++) {
+		uint32_t block = overview->outdated_blocks[i];
+		unsigned x = block % overview->level_widths[0], y = block / overview->level_widths[0], level;
+		struct minesweeper_tile_counts counts = count_block(game, x, y), *cell = &overview->levels[0][block];
+		struct minesweeper_tile_counts difference;
+
+		overview->outdated_bits[block / 32] &= ~((uint32_t)1 << (block % 32));
+		difference.opened = counts.opened - cell->opened;
+		difference.flagged = counts.flagged - cell->flagged;
+		difference.revealed_mines = counts.revealed_mines - cell->revealed_mines;
+		if (difference.opened == 0 && difference.flagged == 0 && difference.revealed_mines == 0)
+			continue;
+		*cell = counts;
+		for (level = 1; level < overview->level_count; level++) {
+			x /= 2;
+			y /= 2;
+			add_counts(&overview->levels[level][y * overview->level_widths[level] + x], &difference);
+		}
+	}
+	overview->outdated_block_count = 0;
+}
+
+const struct minesweeper_tile_counts *minesweeper_get_overview(struct minesweeper_game *game, unsigned level, unsigned *width, unsigned *height) {
+	struct minesweeper_overview *overview = game->overview;
+	if (level >= overview->level_count)
+		return NULL;
+	if (overview->outdated_block_count > 0)
+		update_outdated_blocks(game);
+	*width = overview->level_widths[level];
+	*height = overview->level_heights[level];
+	return overview->levels[level];
+}
+
+unsigned minesweeper_overview_level_for_size(const struct minesweeper_game *game, unsigned max_width, unsigned max_height) {
+	const struct minesweeper_overview *overview = game->overview;
+	unsigned level;
+	for (level = 0; level + 1 < overview->level_count; level++) {
+		if (overview->level_widths[level] <= max_width && overview->level_heights[level] <= max_height)
+			break;
+	}
+	return level;
+}
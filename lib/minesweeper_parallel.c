@@ -0,0 +1,350 @@
+#include <minesweeper_parallel.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include "minesweeper_internal.h"
+
+/**
+ * A parallel cascade opens the same tiles as run_cascade(): every tile
+ * connected to a pending tile through unopened, unflagged tiles without
+ * adjacent mines, plus the unopened, unflagged tiles adjacent to those.
+ *
+ * Instead of growing the cascade outwards, which is inherently serial,
+ * each thread labels the connected regions in its own strip of rows with
+ * union-find. The regions are then joined across strip borders, and each
+ * thread opens the tiles in its strip that belong to, or are adjacent
+ * to, the region of the pending tiles. Every thread only writes to tiles
+ * in its own strip, so no locks or atomic operations are needed.
+ */
+
+#define NOT_IN_REGION UINT32_MAX
+#define NEWLY_OPENED (UINT32_MAX - 1)
+
+struct parallel_cascade {
+	struct minesweeper_game *game;
+	uint32_t *parent; /* Union-find forest in row-major order, NOT_IN_REGION for tiles that can't be cascaded through */
+	uint8_t *in_region; /* True for tiles connected to the pending tiles */
+	uint32_t root;
+};
+
+struct worker {
+	struct parallel_cascade *cascade;
+	unsigned first_row, end_row;
+	unsigned opened_tile_count;
+	unsigned changed_tile_count; /* Bits this worker set in the change tracker */
+	uint32_t changed_word, changed_bits; /* Change tracker bits not yet written, see track_change() */
+	unsigned min_x, min_y, max_x, max_y; /* Bounding box of the tiles this worker opened */
+	uint64_t visible_hash; /* Keys of the tiles this worker opened, XORed into the game's at the end */
+};
+
+static inline struct minesweeper_tile *tile_at(struct minesweeper_game *game, unsigned x, unsigned y) {
+	return &game->tiles[tile_index(game, x, y)];
+}
+
+static inline bool can_cascade_through(const struct minesweeper_tile *tile) {
+	return tile->reserved || (!tile->is_opened && !tile->has_flag && !tile->has_mine && tile->adjacent_mine_count == 0);
+}
+
+static uint32_t find_root(uint32_t *parent, uint32_t i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+/**
+ * Always links the larger root to the smaller one, so that
+ * parent[i] <= i holds for every tile.
+ */
+static void join(uint32_t *parent, uint32_t a, uint32_t b) {
+	a = find_root(parent, a);
+	b = find_root(parent, b);
+	if (a < b)
+		parent[b] = a;
+	else if (b < a)
+		parent[a] = b;
+}
+
+static void *label_strip(void *context) {
+	struct worker *worker = context;
+	struct minesweeper_game *game = worker->cascade->game;
+	uint32_t *parent = worker->cascade->parent;
+	unsigned width = game->width;
+	unsigned x, y;
+	uint32_t i;
+
+	for (y = worker->first_row; y < worker->end_row; y++) {
+		for (x = 0, i = y * width; x < width; x++, i++) {
+			if (!can_cascade_through(tile_at(game, x, y))) {
+				parent[i] = NOT_IN_REGION;
+				continue;
+			}
+			parent[i] = i;
+			if (x > 0 && parent[i - 1] != NOT_IN_REGION)
+				join(parent, i, i - 1);
+			if (y == worker->first_row)
+				continue;
+			if (x > 0 && parent[i - width - 1] != NOT_IN_REGION)
+				join(parent, i, i - width - 1);
+			if (parent[i - width] != NOT_IN_REGION)
+				join(parent, i, i - width);
+			if (x + 1 < width && parent[i - width + 1] != NOT_IN_REGION)
+				join(parent, i, i - width + 1);
+		}
+	}
+
+	/* Point every tile directly at its root within the strip. Since
+	 * parents always come first, a single pass is enough. */
+	for (i = worker->first_row * width; i < worker->end_row * width; i++) {
+		if (parent[i] != NOT_IN_REGION)
+			parent[i] = parent[parent[i]];
+	}
+	return NULL;
+}
+
+static void *mark_region(void *context) {
+	struct worker *worker = context;
+	uint32_t *parent = worker->cascade->parent;
+	uint32_t i;
+
+	for (i = worker->first_row * worker->cascade->game->width; i < worker->end_row * worker->cascade->game->width; i++) {
+		uint32_t root = i;
+		if (parent[i] == NOT_IN_REGION) {
+			worker->cascade->in_region[i] = false;
+			continue;
+		}
+		/* Other threads are reading the forest too, so don't compress paths here */
+		while (parent[root] != root)
+			root = parent[root];
+		worker->cascade->in_region[i] = root == worker->cascade->root;
+	}
+	return NULL;
+}
+
+static bool is_adjacent_to_region(struct parallel_cascade *cascade, unsigned x, unsigned y) {
+	unsigned width = cascade->game->width;
+	unsigned min_x = x > 0 ? x - 1 : 0, max_x = x + 1 < width ? x + 1 : x;
+	unsigned min_y = y > 0 ? y - 1 : 0, max_y = y + 1 < cascade->game->height ? y + 1 : y;
+	unsigned ax, ay;
+	for (ay = min_y; ay <= max_y; ay++) {
+		for (ax = min_x; ax <= max_x; ax++) {
+			if (cascade->in_region[ay * width + ax])
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Writes the collected bits of a word of the change tracker. Strips
+ * may share a word where they meet, so the bits are ORed atomically.
+ */
+static void flush_changes(struct worker *worker, struct minesweeper_change_tracker *tracker) {
+	uint32_t word = worker->changed_word;
+	uint32_t previous;
+	if (worker->changed_bits == 0)
+		return;
+	previous = __atomic_fetch_or(&tracker->tile_bits[word], worker->changed_bits, __ATOMIC_RELAXED);
+	__atomic_fetch_or(&tracker->word_bits[word / 32], (uint32_t)1 << (word % 32), __ATOMIC_RELAXED);
+	worker->changed_tile_count += __builtin_popcount(worker->changed_bits & ~previous);
+	worker->changed_bits = 0;
+}
+
+/**
+ * Tiles are opened in row-major order, so the bits of each word
+ * of the change tracker are collected and written at once.
+ */
+static inline void track_change(struct worker *worker, struct minesweeper_change_tracker *tracker, uint32_t index) {
+	if (index / 32 != worker->changed_word) {
+		flush_changes(worker, tracker);
+		worker->changed_word = index / 32;
+	}
+	worker->changed_bits |= (uint32_t)1 << (index % 32);
+}
+
+static void *open_strip(void *context) {
+	struct worker *worker = context;
+	struct parallel_cascade *cascade = worker->cascade;
+	struct minesweeper_change_tracker *tracker = cascade->game->change_tracker;
+	unsigned x, y;
+
+	for (y = worker->first_row; y < worker->end_row; y++) {
+		for (x = 0; x < cascade->game->width; x++) {
+			struct minesweeper_tile *tile = tile_at(cascade->game, x, y);
+			tile->reserved = false;
+			if (tile->is_opened || tile->has_flag || !is_adjacent_to_region(cascade, x, y))
+				continue;
+			tile->is_opened = true;
+			if (worker->opened_tile_count++ == 0) {
+				worker->min_x = worker->max_x = x;
+				worker->min_y = y;
+			}
+			if (x < worker->min_x)
+				worker->min_x = x;
+			if (x > worker->max_x)
+				worker->max_x = x;
+			worker->max_y = y;
+			worker->visible_hash ^= zobrist_key((size_t)y * cascade->game->width + x, ZOBRIST_OPENED);
+			if (tracker != NULL)
+				track_change(worker, tracker, y * cascade->game->width + x);
+			/* The forest isn't needed anymore, so reuse it to remember which tiles to send callbacks for */
+			cascade->parent[y * cascade->game->width + x] = NEWLY_OPENED;
+		}
+	}
+	if (tracker != NULL)
+		flush_changes(worker, tracker);
+	return NULL;
+}
+
+void run_workers(void *workers, size_t worker_size, unsigned count, void *(*function)(void *)) {
+	uint8_t *worker_bytes = workers;
+	pthread_t *threads = count > 1 ? malloc(sizeof(pthread_t) * count) : NULL;
+	unsigned i, started;
+	for (started = 1; threads != NULL && started < count; started++) {
+		if (pthread_create(&threads[started], NULL, function, worker_bytes + started * worker_size) != 0)
+			break;
+	}
+	function(workers);
+	for (i = started; i < count; i++) {
+		function(worker_bytes + i * worker_size);
+	}
+	for (i = 1; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+/**
+ * Join regions across strip borders, as well as all pending tiles,
+ * so that the whole cascade ends up with a single root.
+ */
+static void join_strips(struct parallel_cascade *cascade, struct worker *workers, unsigned count, struct minesweeper_cascade *pending) {
+	struct minesweeper_game *game = cascade->game;
+	uint32_t *parent = cascade->parent;
+	unsigned width = game->width;
+	uint32_t first_pending = NOT_IN_REGION;
+	unsigned x, y, w;
+
+	for (w = 1; w < count; w++) {
+		uint32_t i = workers[w].first_row * width;
+		for (x = 0; x < width; x++, i++) {
+			if (parent[i] == NOT_IN_REGION)
+				continue;
+			if (x > 0 && parent[i - width - 1] != NOT_IN_REGION)
+				join(parent, i, i - width - 1);
+			if (parent[i - width] != NOT_IN_REGION)
+				join(parent, i, i - width);
+			if (x + 1 < width && parent[i - width + 1] != NOT_IN_REGION)
+				join(parent, i, i - width + 1);
+		}
+	}
+
+	for (y = pending->min_y; y <= pending->max_y; y++) {
+		for (x = pending->min_x; x <= pending->max_x; x++) {
+			if (!tile_at(game, x, y)->reserved)
+				continue;
+			if (first_pending == NOT_IN_REGION)
+				first_pending = y * width + x;
+			else
+				join(parent, first_pending, y * width + x);
+		}
+	}
+	cascade->root = find_root(parent, first_pending);
+}
+
+static bool run_parallel_cascade(struct minesweeper_game *game, struct minesweeper_cascade *pending, unsigned thread_count) {
+	size_t tile_count = (size_t)game->width * game->height;
+	struct parallel_cascade cascade;
+	struct worker *workers;
+	unsigned opened_tile_count = 0;
+	unsigned min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+	unsigned i;
+
+	if (thread_count > game->height)
+		thread_count = game->height;
+	cascade.game = game;
+	cascade.parent = malloc(sizeof(uint32_t) * tile_count);
+	cascade.in_region = malloc(tile_count);
+	workers = malloc(sizeof(struct worker) * thread_count);
+	if (tile_count >= NEWLY_OPENED || !cascade.parent || !cascade.in_region || !workers) {
+		free(cascade.parent);
+		free(cascade.in_region);
+		free(workers);
+		return false;
+	}
+
+	for (i = 0; i < thread_count; i++) {
+		workers[i].cascade = &cascade;
+		workers[i].first_row = (unsigned)((uint64_t)game->height * i / thread_count);
+		workers[i].end_row = (unsigned)((uint64_t)game->height * (i + 1) / thread_count);
+		workers[i].opened_tile_count = 0;
+		workers[i].changed_tile_count = 0;
+		workers[i].changed_word = 0;
+		workers[i].changed_bits = 0;
+		workers[i].visible_hash = 0;
+	}
+
+	run_workers(workers, sizeof(struct worker), thread_count, label_strip);
+	join_strips(&cascade, workers, thread_count, pending);
+	run_workers(workers, sizeof(struct worker), thread_count, mark_region);
+	run_workers(workers, sizeof(struct worker), thread_count, open_strip);
+
+	for (i = 0; i < thread_count; i++) {
+		struct worker *worker = &workers[i];
+		if (worker->opened_tile_count == 0)
+			continue;
+		if (opened_tile_count == 0) {
+			min_x = worker->min_x;
+			max_x = worker->max_x;
+			min_y = worker->min_y;
+		}
+		if (worker->min_x < min_x)
+			min_x = worker->min_x;
+		if (worker->max_x > max_x)
+			max_x = worker->max_x;
+		max_y = worker->max_y;
+		opened_tile_count += worker->opened_tile_count;
+		game->visible_hash ^= worker->visible_hash;
+		if (game->change_tracker != NULL)
+			game->change_tracker->changed_tile_count += worker->changed_tile_count;
+	}
+	game->opened_tile_count += opened_tile_count;
+	cascade_init(pending);
+	if (game->opened_tile_count == game->width * game->height - game->mine_count && game->state == MINESWEEPER_PLAYING)
+		game->state = MINESWEEPER_WIN;
+
+	/* Callbacks are sent on this thread, so only visit the area that was
+	 * opened. The change tracker was already updated by the workers. */
+	if (opened_tile_count > 0 && (game->tile_update_callback != NULL || game->update_queue != NULL
+		|| game->hint_cache != NULL || game->cursor_index != NULL || game->overview != NULL || game->zero_region_labels != NULL)) {
+		struct minesweeper_change_tracker *tracker = game->change_tracker;
+		unsigned x, y;
+		game->change_tracker = NULL;
+		for (y = min_y; y <= max_y; y++) {
+			for (x = min_x; x <= max_x; x++) {
+				if (cascade.parent[y * game->width + x] != NEWLY_OPENED)
+					continue;
+				if (game->zero_region_labels != NULL)
+					mark_zero_region_opened(game, x, y);
+				send_update_callback(game, tile_at(game, x, y));
+			}
+		}
+		game->change_tracker = tracker;
+	}
+
+	free(cascade.parent);
+	free(cascade.in_region);
+	free(workers);
+	return true;
+}
+
+void minesweeper_open_tile_parallel(struct minesweeper_game *game, struct minesweeper_tile *tile, unsigned thread_count) {
+	struct minesweeper_cascade *pending = &game->cascade;
+	start_game(game, tile);
+	_open_tile(game, tile, pending);
+	if (pending->pending_count == 0)
+		return;
+	/* Checkpoints aren't thread safe, and strips don't wrap around or follow
+	 * hexagonal adjacency, so cascade on this thread in those cases */
+	if (thread_count <= 1 || game->checkpoint != NULL || game_topology(game) != BOUNDED || !run_parallel_cascade(game, pending, thread_count))
+		run_cascade(game, pending, UNLIMITED_TILES);
+}
@@ -0,0 +1,125 @@
+#include <minesweeper_queue.h>
+#include "minesweeper_internal.h"
+
+#if !defined(__GNUC__) && defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define USE_STDATOMIC
+#elif !defined(__GNUC__) && !defined(MINESWEEPER_SINGLE_THREADED_QUEUE)
+#error "The update queue needs GCC atomics or C11 atomics. Define MINESWEEPER_SINGLE_THREADED_QUEUE to only use it from one thread."
+#endif
+
+/**
+ * head and tail count the records ever popped and pushed, wrapping
+ * around at 2^32. The game thread publishes a record by storing tail
+ * after writing it, and the consumer frees a slot by storing head after
+ * reading it, so each index is only ever written by one thread.
+ */
+
+static inline uint32_t load_acquire(const uint32_t *value) {
+#if defined(__GNUC__)
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#elif defined(USE_STDATOMIC)
+	/* The same size and representation as uint32_t on every supported platform */
+	return atomic_load_explicit((const _Atomic uint32_t *)value, memory_order_acquire);
+#else
+	return *value;
+#endif
+}
+
+static inline void store_release(uint32_t *location, uint32_t value) {
+#if defined(__GNUC__)
+	__atomic_store_n(location, value, __ATOMIC_RELEASE);
+#elif defined(USE_STDATOMIC)
+	atomic_store_explicit((_Atomic uint32_t *)location, value, memory_order_release);
+#else
+	*location = value;
+#endif
+}
+
+size_t minesweeper_update_queue_buffer_size(uint32_t capacity) {
+	return sizeof(struct minesweeper_update_queue) + sizeof(struct minesweeper_update) * capacity;
+}
+
+struct minesweeper_update_queue *minesweeper_queue_updates(struct minesweeper_game *game, uint32_t capacity, uint8_t *buffer) {
+	struct minesweeper_update_queue *queue = (struct minesweeper_update_queue *)buffer;
+	/* Indices are masked with capacity - 1 */
+	if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		return NULL;
+	queue->records = (struct minesweeper_update *)(buffer + sizeof(struct minesweeper_update_queue));
+	queue->capacity = capacity;
+	queue->width = game->width;
+	queue->tail = 0;
+	queue->has_dirty_region = false;
+	queue->head = 0;
+	game->update_queue = queue;
+	return queue;
+}
+
+static bool push(struct minesweeper_update_queue *queue, const struct minesweeper_update *update) {
+	uint32_t tail = queue->tail;
+	if (tail - load_acquire(&queue->head) == queue->capacity)
+		return false;
+	queue->records[tail & (queue->capacity - 1)] = *update;
+	store_release(&queue->tail, tail + 1);
+	return true;
+}
+
+static void add_dirty_region(struct minesweeper_update_queue *queue, unsigned min_x, unsigned min_y, unsigned max_x, unsigned max_y) {
+	if (!queue->has_dirty_region) {
+		queue->has_dirty_region = true;
+		queue->dirty_min_x = min_x;
+		queue->dirty_min_y = min_y;
+		queue->dirty_max_x = max_x;
+		queue->dirty_max_y = max_y;
+		return;
+	}
+	if (min_x < queue->dirty_min_x)
+		queue->dirty_min_x = min_x;
+	if (min_y < queue->dirty_min_y)
+		queue->dirty_min_y = min_y;
+	if (max_x > queue->dirty_max_x)
+		queue->dirty_max_x = max_x;
+	if (max_y > queue->dirty_max_y)
+		queue->dirty_max_y = max_y;
+}
+
+static bool push_region(struct minesweeper_update_queue *queue, unsigned min_x, unsigned min_y, unsigned max_x, unsigned max_y) {
+	struct minesweeper_update update = { 0 };
+	update.index = min_y * queue->width + min_x;
+	update.last_index = max_y * queue->width + max_x;
+	update.is_region = true;
+	return push(queue, &update);
+}
+
+bool minesweeper_update_queue_flush(struct minesweeper_update_queue *queue) {
+	if (!queue->has_dirty_region)
+		return true;
+	if (!push_region(queue, queue->dirty_min_x, queue->dirty_min_y, queue->dirty_max_x, queue->dirty_max_y))
+		return false;
+	queue->has_dirty_region = false;
+	return true;
+}
+
+/* A pending dirty region is always pushed first, so that later records don't overtake it */
+
+void queue_tile_update(struct minesweeper_update_queue *queue, size_t index, const struct minesweeper_tile *tile) {
+	struct minesweeper_update update;
+	update.index = update.last_index = index;
+	update.tile = *tile;
+	update.tile.reserved = false;
+	update.is_region = false;
+	if (!minesweeper_update_queue_flush(queue) || !push(queue, &update))
+		add_dirty_region(queue, index % queue->width, index / queue->width, index % queue->width, index / queue->width);
+}
+
+size_t minesweeper_update_queue_pop(struct minesweeper_update_queue *queue, struct minesweeper_update *out, size_t max_count) {
+	uint32_t head = queue->head;
+	uint32_t available = load_acquire(&queue->tail) - head;
+	size_t count = available < max_count ? available : max_count;
+	size_t i;
+	for (i = 0; i < count; i++) {
+		out[i] = queue->records[(head + i) & (queue->capacity - 1)];
+	}
+	store_release(&queue->head, head + count);
+	return count;
+}
@@ -0,0 +1,362 @@
+#include <minesweeper.h>
+#include <string.h>
+#include "minesweeper_internal.h"
+
+/**
+ * With MINESWEEPER_LABEL_ZERO_REGIONS, the connected regions of tiles
+ * without adjacent mines are found on the first cascade after mines are
+ * generated or moved. A cascade from any tile in a region always opens
+ * the whole region and its border, unless part of it is already opened
+ * or flagged, so the region can then be opened with a single scan of
+ * its bounding box.
+ *
+ * Regions are found with a scanline flood fill. Its stack of run starts
+ * is as large as the cascade queue, and when it overflows, the region's
+ * bounding box is rescanned for the runs that were left out, much like
+ * queue_unqueued_tiles() finds pending tiles again. While labelling,
+ * zero tiles of regions that are too small to label are marked with
+ * UNLABELLED.
+ */
+
+#define UNLABELLED MINESWEEPER_MULTIPLE_REGIONS
+
+static inline struct minesweeper_tile *tile_at(struct minesweeper_game *game, unsigned x, unsigned y) {
+	return &game->tiles[tile_index(game, x, y)];
+}
+
+struct region_fill {
+	struct minesweeper_game *game;
+	uint16_t from, to;
+	uint32_t *stack;
+	unsigned stack_length;
+	bool overflowed;
+	size_t size;
+	struct minesweeper_zero_region *region; /* Bounding box of the filled tiles, and whether any is opened */
+};
+
+static inline bool is_unfilled(struct region_fill *fill, unsigned x, unsigned y) {
+	return fill->game->zero_region_labels[(size_t)y * fill->game->width + x] == fill->from && is_zero_tile(tile_at(fill->game, x, y));
+}
+
+static void push_run_starts(struct region_fill *fill, unsigned min_x, unsigned max_x, unsigned y) {
+	unsigned x;
+	bool was_unfilled = false;
+	for (x = min_x; x <= max_x; x++) {
+		bool unfilled = is_unfilled(fill, x, y);
+		if (unfilled && !was_unfilled) {
+			if (fill->stack_length < fill->game->cascade.queue_capacity)
+				fill->stack[fill->stack_length++] = (uint32_t)y * fill->game->width + x;
+			else
+				fill->overflowed = true;
+		}
+		was_unfilled = unfilled;
+	}
+}
+
+/* Fills the run of unfilled tiles around (x, y), and pushes the runs adjacent to it */
+static void fill_run(struct region_fill *fill, unsigned x, unsigned y) {
+	struct minesweeper_game *game = fill->game;
+	struct minesweeper_zero_region *region = fill->region;
+	uint16_t *labels = game->zero_region_labels + (size_t)y * game->width;
+	unsigned min_x = x, max_x = x;
+
+	while (min_x > 0 && is_unfilled(fill, min_x - 1, y))
+		min_x--;
+	while (max_x + 1 < game->width && is_unfilled(fill, max_x + 1, y))
+		max_x++;
+	for (x = min_x; x <= max_x; x++) {
+		labels[x] = fill->to;
+		if (tile_at(game, x, y)->is_opened)
+			region->is_opened = true;
+	}
+	fill->size += max_x - min_x + 1;
+	if (min_x < region->min_x)
+		region->min_x = min_x;
+	if (max_x > region->max_x)
+		region->max_x = max_x;
+	if (y < region->min_y)
+		region->min_y = y;
+	if (y > region->max_y)
+		region->max_y = y;
+
+	if (min_x > 0)
+		min_x--;
+	if (max_x + 1 < game->width)
+		max_x++;
+	if (y > 0)
+		push_run_starts(fill, min_x, max_x, y - 1);
+	if (y + 1 < game->height)
+		push_run_starts(fill, min_x, max_x, y + 1);
+}
+
+static bool has_filled_neighbour(struct region_fill *fill, unsigned x, unsigned y) {
+	unsigned min_x = x > 0 ? x - 1 : 0, max_x = x + 1 < fill->game->width ? x + 1 : x;
+	unsigned min_y = y > 0 ? y - 1 : 0, max_y = y + 1 < fill->game->height ? y + 1 : y;
+	unsigned ax, ay;
+	for (ay = min_y; ay <= max_y; ay++) {
+		for (ax = min_x; ax <= max_x; ax++) {
+			if (fill->game->zero_region_labels[(size_t)ay * fill->game->width + ax] == fill->to)
+				return true;
+		}
+	}
+	return false;
+}
+
+static void fill_stacked_runs(struct region_fill *fill) {
+	unsigned width = fill->game->width;
+	while (fill->stack_length > 0) {
+		uint32_t i = fill->stack[--fill->stack_length];
+		if (is_unfilled(fill, i % width, i / width))
+			fill_run(fill, i % width, i / width);
+	}
+}
+
+/**
+ * Relabels the zero tiles labelled fill->from that are connected to
+ * (x, y) as fill->to, and returns how many there were.
+ */
+static size_t fill_region(struct region_fill *fill, unsigned x, unsigned y) {
+	struct minesweeper_game *game = fill->game;
+	struct minesweeper_zero_region *region = fill->region;
+	unsigned ax, ay;
+
+	fill->size = 0;
+	fill->stack_length = 0;
+	fill->overflowed = false;
+	region->min_x = region->max_x = x;
+	region->min_y = region->max_y = y;
+	region->is_opened = false;
+	fill_run(fill, x, y);
+	fill_stacked_runs(fill);
+
+	/* Runs that didn't fit on the stack are unfilled tiles next to filled
+	 * ones, so they're within a tile of the bounding box. Since zero tiles
+	 * of other regions are never adjacent, any adjacent fill->to label is
+	 * a filled tile. */
+	while (fill->overflowed) {
+		fill->overflowed = false;
+		for (ay = region->min_y > 0 ? region->min_y - 1 : 0; ay <= region->max_y + 1 && ay < game->height; ay++) {
+			for (ax = region->min_x > 0 ? region->min_x - 1 : 0; ax <= region->max_x + 1 && ax < game->width; ax++) {
+				if (is_unfilled(fill, ax, ay) && has_filled_neighbour(fill, ax, ay)) {
+					fill_run(fill, ax, ay);
+					fill_stacked_runs(fill);
+				}
+			}
+		}
+	}
+	return fill->size;
+}
+
+/**
+ * Adds modifier to the flag count of every region that the tile at
+ * (x, y) is in or on the border of.
+ */
+static void adjust_region_flag_counts(struct minesweeper_game *game, unsigned x, unsigned y, int modifier) {
+	uint16_t label = game->zero_region_labels[(size_t)y * game->width + x];
+	uint16_t seen[8];
+	unsigned seen_count = 0, i;
+	unsigned min_x, max_x, min_y, max_y, ax, ay;
+
+	if (label != MINESWEEPER_MULTIPLE_REGIONS) {
+		if (label != 0)
+			game->zero_regions[label - 1].flag_count += modifier;
+		return;
+	}
+
+	/* On the border of several regions, which are the regions of the adjacent zero tiles */
+	min_x = x > 0 ? x - 1 : 0;
+	max_x = x + 1 < game->width ? x + 1 : x;
+	min_y = y > 0 ? y - 1 : 0;
+	max_y = y + 1 < game->height ? y + 1 : y;
+	for (ay = min_y; ay <= max_y; ay++) {
+		for (ax = min_x; ax <= max_x; ax++) {
+			if (!is_zero_tile(tile_at(game, ax, ay)))
+				continue;
+			label = game->zero_region_labels[(size_t)ay * game->width + ax];
+			for (i = 0; i < seen_count && seen[i] != label; i++)
+				;
+			if (label == 0 || i < seen_count)
+				continue;
+			seen[seen_count++] = label;
+			game->zero_regions[label - 1].flag_count += modifier;
+		}
+	}
+}
+
+/**
+ * Label of a tile that isn't a zero tile, based on the labels of its
+ * adjacent zero tiles.
+ */
+static uint16_t border_label(struct minesweeper_game *game, unsigned x, unsigned y) {
+	unsigned min_x = x > 0 ? x - 1 : 0, max_x = x + 1 < game->width ? x + 1 : x;
+	unsigned min_y = y > 0 ? y - 1 : 0, max_y = y + 1 < game->height ? y + 1 : y;
+	unsigned ax, ay;
+	uint16_t label = 0;
+	for (ay = min_y; ay <= max_y; ay++) {
+		for (ax = min_x; ax <= max_x; ax++) {
+			uint16_t adjacent_label;
+			if (!is_zero_tile(tile_at(game, ax, ay)))
+				continue;
+			/* Zero tiles further on may still be marked as unlabelled */
+			adjacent_label = game->zero_region_labels[(size_t)ay * game->width + ax];
+			if (adjacent_label == 0 || adjacent_label == UNLABELLED || adjacent_label == label)
+				continue;
+			if (label != 0)
+				return MINESWEEPER_MULTIPLE_REGIONS;
+			label = adjacent_label;
+		}
+	}
+	return label;
+}
+
+void label_zero_regions(struct minesweeper_game *game) {
+	uint16_t *labels = game->zero_region_labels;
+	unsigned width = game->width, height = game->height;
+	unsigned capacity = zero_region_capacity(width, height);
+	struct minesweeper_zero_region unlabelled;
+	struct region_fill fill;
+	unsigned x, y;
+	size_t i;
+
+	/* Fill the regions in row-major order of their first tile */
+	memset(labels, 0, sizeof(uint16_t) * width * height);
+	fill.game = game;
+	fill.stack = game->zero_region_fill_stack;
+	game->zero_region_count = 0;
+	for (y = 0, i = 0; y < height; y++) {
+		for (x = 0; x < width; x++, i++) {
+			if (labels[i] != 0 || !is_zero_tile(tile_at(game, x, y)))
+				continue;
+			fill.from = 0;
+			if (game->zero_region_count == capacity) {
+				fill.to = UNLABELLED;
+				fill.region = &unlabelled;
+				fill_region(&fill, x, y);
+				continue;
+			}
+			fill.to = game->zero_region_count + 1;
+			fill.region = &game->zero_regions[game->zero_region_count];
+			if (fill_region(&fill, x, y) >= MINESWEEPER_MIN_LABELLED_REGION_SIZE) {
+				fill.region->flag_count = 0;
+				game->zero_region_count++;
+				continue;
+			}
+			fill.from = fill.to;
+			fill.to = UNLABELLED;
+			fill.region = &unlabelled;
+			fill_region(&fill, x, y);
+		}
+	}
+
+	/* Label the borders, and count flags on regions and their borders */
+	for (y = 0, i = 0; y < height; y++) {
+		for (x = 0; x < width; x++, i++) {
+			if (!is_zero_tile(tile_at(game, x, y)))
+				labels[i] = border_label(game, x, y);
+			else if (labels[i] == UNLABELLED)
+				labels[i] = 0;
+		}
+	}
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			if (tile_at(game, x, y)->has_flag)
+				adjust_region_flag_counts(game, x, y, 1);
+		}
+	}
+	for (i = 0; i < game->zero_region_count; i++) {
+		struct minesweeper_zero_region *region = &game->zero_regions[i];
+		if (region->min_x > 0)
+			region->min_x--;
+		if (region->min_y > 0)
+			region->min_y--;
+		if (region->max_x + 1 < width)
+			region->max_x++;
+		if (region->max_y + 1 < height)
+			region->max_y++;
+	}
+	game->zero_regions_outdated = false;
+}
+
+void update_zero_region_flag_counts(struct minesweeper_game *game, struct minesweeper_tile *tile) {
+	unsigned x, y;
+	minesweeper_get_tile_location(game, tile, &x, &y);
+	adjust_region_flag_counts(game, x, y, tile->has_flag ? 1 : -1);
+}
+
+void mark_zero_region_opened(struct minesweeper_game *game, unsigned x, unsigned y) {
+	uint16_t label = game->zero_region_labels[(size_t)y * game->width + x];
+	if (!game->zero_regions_outdated && label != 0 && is_zero_tile(tile_at(game, x, y)))
+		game->zero_regions[label - 1].is_opened = true;
+}
+
+static bool borders_region(struct minesweeper_game *game, unsigned x, unsigned y, uint16_t label) {
+	unsigned min_x = x > 0 ? x - 1 : 0, max_x = x + 1 < game->width ? x + 1 : x;
+	unsigned min_y = y > 0 ? y - 1 : 0, max_y = y + 1 < game->height ? y + 1 : y;
+	unsigned ax, ay;
+	for (ay = min_y; ay <= max_y; ay++) {
+		for (ax = min_x; ax <= max_x; ax++) {
+			if (game->zero_region_labels[(size_t)ay * game->width + ax] == label && is_zero_tile(tile_at(game, ax, ay)))
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Whether the tile at (x, y) is an unopened tile of the region with a
+ * label, or on its border.
+ */
+static bool opens_with_region(struct minesweeper_game *game, unsigned x, unsigned y, uint16_t label) {
+	uint16_t tile_label = game->zero_region_labels[(size_t)y * game->width + x];
+	if (tile_at(game, x, y)->is_opened)
+		return false;
+	return tile_label == label || (tile_label == MINESWEEPER_MULTIPLE_REGIONS && borders_region(game, x, y, label));
+}
+
+bool open_zero_region(struct minesweeper_game *game, unsigned x, unsigned y) {
+	struct minesweeper_zero_region *region;
+	uint16_t label;
+	unsigned opened_tile_count = 0;
+	unsigned ax, ay;
+
+	if (game->zero_region_labels == NULL || (label = game->zero_region_labels[(size_t)y * game->width + x]) == 0)
+		return false;
+	region = &game->zero_regions[label - 1];
+	if (region->is_opened || region->flag_count > 0) {
+		/* A cascade would stop early, so leave it to run_cascade() */
+		region->is_opened = true;
+		return false;
+	}
+	region->is_opened = true;
+
+	/* Counted first, so that every tile is reported with the counts and
+	 * state the game has once the whole region is opened */
+	for (ay = region->min_y; ay <= region->max_y; ay++) {
+		for (ax = region->min_x; ax <= region->max_x; ax++) {
+			opened_tile_count += opens_with_region(game, ax, ay, label);
+		}
+	}
+	game->opened_tile_count += opened_tile_count;
+	if (all_tiles_opened(game))
+		game->state = MINESWEEPER_WIN;
+
+	for (ay = region->min_y; ay <= region->max_y; ay++) {
+		for (ax = region->min_x; ax <= region->max_x; ax++) {
+			struct minesweeper_tile *region_tile = tile_at(game, ax, ay);
+			if (!opens_with_region(game, ax, ay, label))
+				continue;
+			before_tile_change(game, region_tile - game->tiles);
+			region_tile->is_opened = true;
+			game->visible_hash ^= zobrist_key((size_t)ay * game->width + ax, ZOBRIST_OPENED);
+			/* The area callback replaces the tile callbacks, but not the rest */
+			if (game->area_update_callback != NULL)
+				record_tile_update(game, region_tile);
+			else
+				send_update_callback(game, region_tile);
+		}
+	}
+
+	if (game->area_update_callback != NULL)
+		game->area_update_callback(game, region->min_x, region->min_y, region->max_x, region->max_y, game->user_info);
+	return true;
+}
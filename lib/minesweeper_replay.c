@@ -0,0 +1,74 @@
+#include <minesweeper_replay.h>
+#include "minesweeper_internal.h"
+
+/**
+ * Whether the tile count, and the number of mines placed from it, fit in
+ * an unsigned int. A NaN density fails both comparisons.
+ */
+static bool is_valid_board(const struct minesweeper_replay *replay) {
+	if (replay->width == 0 || replay->height == 0)
+		return false;
+	/* The cascade queue holds 2 * (width + height) tiles */
+	if (replay->width > UINT_MAX / 4 || replay->height > UINT_MAX / 4 || replay->width > UINT_MAX / replay->height)
+		return false;
+	return replay->mine_density >= 0.0f && replay->mine_density <= 1.0f;
+}
+
+/**
+ * Finds actions on tiles that the game would ignore. Called once the
+ * action is known to be in bounds.
+ */
+static enum minesweeper_replay_verdict check_tile_action(struct minesweeper_game *game, const struct minesweeper_action *action) {
+	struct minesweeper_tile *tile = &game->tiles[tile_index(game, action->x, action->y)];
+	uint8_t adjacent_flags;
+
+	if (!tile->is_opened) {
+		if (action->type == MINESWEEPER_ACTION_OPEN && tile->has_flag)
+			return MINESWEEPER_REPLAY_OPENED_FLAGGED_TILE;
+		return MINESWEEPER_REPLAY_VALID;
+	}
+	if (action->type == MINESWEEPER_ACTION_TOGGLE_FLAG || tile->adjacent_mine_count == 0)
+		return MINESWEEPER_REPLAY_TILE_ALREADY_OPENED;
+	if (game->adjacent_flag_counts != NULL)
+		adjacent_flags = game->adjacent_flag_counts[tile - game->tiles];
+	else
+		adjacent_flags = count_adjacent_flags(game, tile);
+	return adjacent_flags == tile->adjacent_mine_count ? MINESWEEPER_REPLAY_VALID : MINESWEEPER_REPLAY_TILE_ALREADY_OPENED;
+}
+
+size_t minesweeper_replay_buffer_size(const struct minesweeper_replay *replay) {
+	if (!is_valid_board(replay))
+		return 0;
+	return minesweeper_buffer_size_with_options(replay->width, replay->height, replay->options);
+}
+
+enum minesweeper_replay_verdict minesweeper_verify_replay(const struct minesweeper_replay *replay, uint8_t *buffer) {
+	struct minesweeper_game *game;
+	enum minesweeper_replay_verdict verdict;
+	size_t i;
+
+	if (!is_valid_board(replay))
+		return MINESWEEPER_REPLAY_INVALID_BOARD;
+	game = minesweeper_init_with_seed(replay->width, replay->height, replay->mine_density, replay->options, replay->seed, buffer);
+	if (game == NULL)
+		return MINESWEEPER_REPLAY_INVALID_BOARD;
+
+	for (i = 0; i < replay->action_count; i++) {
+		if (validate_action(game, &replay->actions[i]) != MINESWEEPER_ACTION_NO_CHANGE)
+			return MINESWEEPER_REPLAY_INVALID_ACTION;
+		if (game->state == MINESWEEPER_GAME_OVER || game->state == MINESWEEPER_WIN)
+			return MINESWEEPER_REPLAY_ACTION_AFTER_END;
+		if ((verdict = check_tile_action(game, &replay->actions[i])) != MINESWEEPER_REPLAY_VALID)
+			return verdict;
+		if (replay->timestamps != NULL && i > 0 && replay->timestamps[i] < replay->timestamps[i - 1])
+			return MINESWEEPER_REPLAY_TIME_WENT_BACKWARDS;
+		apply_action(game, &replay->actions[i]);
+	}
+
+	if (replay->timestamps != NULL && replay->action_count > 0
+		&& replay->timestamps[replay->action_count - 1] - replay->timestamps[0] != replay->claimed_time)
+		return MINESWEEPER_REPLAY_WRONG_TIME;
+	if (game->state != replay->claimed_state)
+		return MINESWEEPER_REPLAY_WRONG_STATE;
+	return MINESWEEPER_REPLAY_VALID;
+}
@@ -0,0 +1,61 @@
+#include <minesweeper_replay.h>
+#include <stdlib.h>
+#include "minesweeper_internal.h"
+
+struct replay_worker {
+	const struct minesweeper_replay *replays;
+	enum minesweeper_replay_verdict *verdicts;
+	size_t first, end;
+	uint8_t *buffer;
+};
+
+static void *verify_replay_range(void *context) {
+	struct replay_worker *worker = context;
+	size_t i;
+	for (i = worker->first; i < worker->end; i++) {
+		worker->verdicts[i] = minesweeper_verify_replay(&worker->replays[i], worker->buffer);
+	}
+	return NULL;
+}
+
+bool minesweeper_verify_replays(const struct minesweeper_replay *replays, size_t count, enum minesweeper_replay_verdict *verdicts, unsigned thread_count) {
+	struct replay_worker *workers;
+	size_t buffer_size = 0;
+	unsigned i;
+	bool allocated = true;
+
+	if (thread_count == 0)
+		thread_count = 1;
+	if (thread_count > count)
+		thread_count = count > 0 ? count : 1;
+	for (i = 0; i < count; i++) {
+		size_t size = minesweeper_replay_buffer_size(&replays[i]);
+		if (size > buffer_size)
+			buffer_size = size;
+	}
+
+	workers = calloc(thread_count, sizeof(struct replay_worker));
+	for (i = 0; workers != NULL && i < thread_count; i++) {
+		workers[i].replays = replays;
+		workers[i].verdicts = verdicts;
+		workers[i].first = count * i / thread_count;
+		workers[i].end = count * (i + 1) / thread_count;
+		workers[i].buffer = malloc(buffer_size);
+		allocated = allocated && workers[i].buffer != NULL;
+	}
+	if (workers == NULL || !allocated) {
+		for (i = 0; workers != NULL && i < thread_count; i++) {
+			free(workers[i].buffer);
+		}
+		free(workers);
+		return false;
+	}
+
+	run_workers(workers, sizeof(struct replay_worker), thread_count, verify_replay_range);
+
+	for (i = 0; i < thread_count; i++) {
+		free(workers[i].buffer);
+	}
+	free(workers);
+	return true;
+}
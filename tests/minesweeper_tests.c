@@ -1,7 +1,19 @@
 #include <minunit.h>
 #include <stdio.h>
 #include <minesweeper.h>
+#include <minesweeper_delta.h>
+#include <minesweeper_parallel.h>
+#include <minesweeper_queue.h>
+#include <minesweeper_checkpoint.h>
+#include <minesweeper_batch.h>
+#include <minesweeper_replay.h>
+#include <minesweeper_metrics.h>
+#include <minesweeper_hint.h>
+#include <minesweeper_cursor.h>
+#include <minesweeper_overview.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 int tests_run = 0;
 int width = 120;
@@ -230,6 +242,1274 @@ static char * test_space_open_tile(void) {
 	return 0;
 }
 
+static char * test_adjacent_flag_counts(void) {
+	uint8_t *buffer = malloc(minesweeper_buffer_size_with_options(width, height, MINESWEEPER_TRACK_ADJACENT_FLAGS));
+	struct minesweeper_tile *center_tile;
+	struct minesweeper_tile *mine_tile;
+	unsigned center_index;
+
+	puts("Test: Adjacent flag counters...");
+	game = minesweeper_init_with_options(width, height, 0.0, MINESWEEPER_TRACK_ADJACENT_FLAGS, buffer);
+	mu_assert("Error: adjacent_flag_counts must be set when MINESWEEPER_TRACK_ADJACENT_FLAGS is used.", game->adjacent_flag_counts != NULL);
+	center_tile = minesweeper_get_tile_at(game, 10, 10);
+	center_index = center_tile - game->tiles;
+	mine_tile = minesweeper_get_tile_at(game, 9, 9);
+	minesweeper_toggle_mine(game, mine_tile);
+
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 11, 11));
+	minesweeper_toggle_flag(game, mine_tile);
+	mu_assert("Error: the tile at (10, 10) must have a flag count of 2 after flags have been placed at (9, 9) and (11, 11).", game->adjacent_flag_counts[center_index] == 2);
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 11, 11));
+	mu_assert("Error: the tile at (10, 10) must have a flag count of 1 after the flag at (11, 11) was removed.", game->adjacent_flag_counts[center_index] == 1);
+
+	minesweeper_set_cursor(game, 10, 10);
+	minesweeper_open_tile(game, game->selected_tile);
+	mu_assert("Error: a tile next to a mine must not cascade when opened.", game->opened_tile_count == 1);
+	minesweeper_space_tile(game, game->selected_tile);
+	mu_assert("Error: quick-opening a tile with the correct number of adjacent flags must open adjacent tiles.", game->state == MINESWEEPER_WIN);
+
+	free(buffer);
+	return 0;
+}
+
+static char * test_flags_stop_cascade(void) {
+	unsigned y;
+	puts("Test: Flags stop cascades...");
+	game = minesweeper_init(width, height, 0.0, game_buffer);
+	for (y = 0; y < (unsigned)height; y++) {
+		minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 5, y));
+	}
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 0, 0));
+	mu_assert("Error: a cascade must not open tiles behind a line of flags.", game->opened_tile_count == 5u * height);
+	mu_assert("Error: a cascade must not open flagged tiles.", !minesweeper_get_tile_at(game, 5, 0)->is_opened);
+	return 0;
+}
+
+static char * test_cascade_moving_up(void) {
+	uint8_t *small_buffer = malloc(minesweeper_minimum_buffer_size(5, 5));
+	unsigned x, y, opened_tile_count = 0;
+
+	puts("Test: Cascade continuing above the opened tile...");
+	/* Only the tile above (2, 2) has no adjacent mines, so the
+	 * cascade has to continue upwards from the opened tile */
+	game = minesweeper_init(5, 5, 0.0, small_buffer);
+	for (x = 0; x < 5; x++) {
+		minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, x, 4));
+	}
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 0, 2));
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 4, 2));
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 2, 2));
+	for (y = 0; y < 5; y++) {
+		for (x = 0; x < 5; x++) {
+			opened_tile_count += minesweeper_get_tile_at(game, x, y)->is_opened;
+		}
+	}
+	mu_assert("Error: a cascade must continue above the opened tile.", minesweeper_get_tile_at(game, 2, 0)->is_opened);
+	mu_assert("Error: the opened tile count must match the opened tiles.", opened_tile_count == game->opened_tile_count);
+	free(small_buffer);
+	return 0;
+}
+
+static char * test_parallel_cascade(void) {
+	unsigned options[] = { 0, MINESWEEPER_TRACK_ADJACENT_FLAGS };
+	unsigned thread_counts[] = { 1, 3, 8 };
+	unsigned o, t, i, x, y;
+
+	puts("Test: Parallel cascades...");
+	for (o = 0; o < 2; o++) {
+		uint8_t *serial_buffer = malloc(minesweeper_buffer_size_with_options(width, height, options[o]));
+		uint8_t *parallel_buffer = malloc(minesweeper_buffer_size_with_options(width, height, options[o]));
+		uint8_t *serial_tracker_buffer = malloc(minesweeper_change_tracker_buffer_size(width, height));
+		uint8_t *parallel_tracker_buffer = malloc(minesweeper_change_tracker_buffer_size(width, height));
+		for (t = 0; t < 3; t++) {
+			struct minesweeper_change_tracker *serial_tracker, *parallel_tracker;
+			size_t tile_words = ((size_t)width * height + 31) / 32;
+			struct minesweeper_game *parallel_game;
+			int callback_count = 0;
+
+			srand(t);
+			game = minesweeper_init_with_options(width, height, 0.03, options[o], serial_buffer);
+			srand(t);
+			parallel_game = minesweeper_init_with_options(width, height, 0.03, options[o], parallel_buffer);
+			parallel_game->tile_update_callback = &callback;
+			parallel_game->user_info = &callback_count;
+			for (i = 0; i < 40; i++) {
+				x = rand() % width;
+				y = rand() % height;
+				minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, x, y));
+				minesweeper_toggle_flag(parallel_game, minesweeper_get_tile_at(parallel_game, x, y));
+			}
+			callback_count = 0;
+			serial_tracker = minesweeper_track_changes(game, serial_tracker_buffer);
+			parallel_tracker = minesweeper_track_changes(parallel_game, parallel_tracker_buffer);
+
+			minesweeper_open_tile(game, minesweeper_get_tile_at(game, width / 2, height / 2));
+			minesweeper_open_tile_parallel(parallel_game, minesweeper_get_tile_at(parallel_game, width / 2, height / 2), thread_counts[t]);
+			mu_assert("Error: a parallel cascade must open as many tiles as a serial one.", game->opened_tile_count == parallel_game->opened_tile_count);
+			mu_assert("Error: a parallel cascade must end in the same state as a serial one.", game->state == parallel_game->state);
+			mu_assert("Error: a parallel cascade must send a callback for every opened tile.", callback_count == (int)parallel_game->opened_tile_count);
+			mu_assert("Error: a parallel cascade must track the same changes as a serial one.", serial_tracker->changed_tile_count == parallel_tracker->changed_tile_count
+				&& memcmp(serial_tracker->tile_bits, parallel_tracker->tile_bits, sizeof(uint32_t) * tile_words) == 0
+				&& memcmp(serial_tracker->word_bits, parallel_tracker->word_bits, sizeof(uint32_t) * ((tile_words + 31) / 32)) == 0);
+			for (y = 0; y < (unsigned)height; y++) {
+				for (x = 0; x < (unsigned)width; x++) {
+					struct minesweeper_tile *tile = minesweeper_get_tile_at(game, x, y);
+					struct minesweeper_tile *parallel_tile = minesweeper_get_tile_at(parallel_game, x, y);
+					mu_assert("Error: a parallel cascade must open the same tiles as a serial one.", tile->is_opened == parallel_tile->is_opened);
+					mu_assert("Error: no tiles may be left pending after a parallel cascade.", !parallel_tile->reserved);
+				}
+			}
+		}
+		free(serial_tracker_buffer);
+		free(parallel_tracker_buffer);
+		free(serial_buffer);
+		free(parallel_buffer);
+	}
+	return 0;
+}
+
+static void area_callback(struct minesweeper_game *game, unsigned min_x, unsigned min_y, unsigned max_x, unsigned max_y, void *user_info) {
+	(void)game; (void)min_x; (void)min_y; (void)max_x; (void)max_y;
+	*((int *)user_info) += 1;
+}
+
+static void count_won_updates(struct minesweeper_game *game, struct minesweeper_tile *tile, void *user_info) {
+	(void)tile;
+	if (game->state == MINESWEEPER_WIN && game->opened_tile_count == game->width * game->height)
+		*((int *)user_info) += 1;
+}
+
+static char * test_zero_regions(void) {
+	uint8_t *labelled_buffer = malloc(minesweeper_buffer_size_with_options(width, height, MINESWEEPER_LABEL_ZERO_REGIONS));
+	uint8_t *tracker_buffer = malloc(minesweeper_change_tracker_buffer_size(width, height));
+	uint8_t *checkpoint_buffer, *large_buffer, *large_labelled_buffer;
+	struct minesweeper_game *labelled_game;
+	struct minesweeper_change_tracker *tracker;
+	int area_callback_count = 0, won_update_count = 0;
+	unsigned seed, i, x, y;
+
+	puts("Test: Zero region labelling...");
+	for (seed = 0; seed < 4; seed++) {
+		srand(seed);
+		game = minesweeper_init(width, height, 0.08, game_buffer);
+		srand(seed);
+		labelled_game = minesweeper_init_with_options(width, height, 0.08, MINESWEEPER_LABEL_ZERO_REGIONS, labelled_buffer);
+		mu_assert("Error: regions must only be labelled on the first cascade.", labelled_game->zero_regions_outdated);
+		labelled_game->area_update_callback = &area_callback;
+		labelled_game->user_info = &area_callback_count;
+
+		/* Flags block some regions, and are removed again from others. The
+		 * first boards are left without flags so that regions open in bulk. */
+		for (i = 0; i < 20; i++) {
+			x = rand() % width;
+			y = rand() % height;
+			minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, x, y));
+			minesweeper_toggle_flag(labelled_game, minesweeper_get_tile_at(labelled_game, x, y));
+			if (i % 2 || seed < 2) {
+				minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, x, y));
+				minesweeper_toggle_flag(labelled_game, minesweeper_get_tile_at(labelled_game, x, y));
+			}
+		}
+		for (i = 0; i < 30 && game->state != MINESWEEPER_GAME_OVER; i++) {
+			x = rand() % width;
+			y = rand() % height;
+			if (minesweeper_get_tile_at(game, x, y)->has_mine && i > 0)
+				continue;
+			minesweeper_open_tile(game, minesweeper_get_tile_at(game, x, y));
+			minesweeper_open_tile(labelled_game, minesweeper_get_tile_at(labelled_game, x, y));
+		}
+
+		mu_assert("Error: labelling must find large zero regions on a sparse board.", labelled_game->zero_region_count > 0);
+		mu_assert("Error: opening labelled regions must open as many tiles as cascading.", game->opened_tile_count == labelled_game->opened_tile_count);
+		mu_assert("Error: opening labelled regions must end in the same state as cascading.", game->state == labelled_game->state);
+		for (i = 0; i < (unsigned)(width * height); i++) {
+			mu_assert("Error: opening labelled regions must open the same tiles as cascading.", game->tiles[i].is_opened == labelled_game->tiles[i].is_opened);
+		}
+	}
+	mu_assert("Error: regions opened in bulk must be reported through the area callback.", area_callback_count > 0);
+
+	/* Without mines, the whole board is a single region */
+	labelled_game = minesweeper_init_with_options(width, height, 0.0, MINESWEEPER_LABEL_ZERO_REGIONS, labelled_buffer);
+	tracker = minesweeper_track_changes(labelled_game, tracker_buffer);
+	labelled_game->tile_update_callback = &count_won_updates;
+	labelled_game->user_info = &won_update_count;
+	minesweeper_open_tile(labelled_game, minesweeper_get_tile_at(labelled_game, 0, 0));
+	mu_assert("Error: tiles opened in bulk must be reported after the counts and state are updated.", won_update_count == width * height - 1);
+	mu_assert("Error: tiles opened in bulk must be tracked as changed.", tracker->changed_tile_count == (unsigned)(width * height));
+
+	/* On a larger board, the flood fill runs out of stack space and rescans */
+	large_buffer = malloc(minesweeper_buffer_size_with_options(512, 512, MINESWEEPER_LABEL_ZERO_REGIONS));
+	large_labelled_buffer = malloc(minesweeper_buffer_size_with_options(512, 512, MINESWEEPER_LABEL_ZERO_REGIONS));
+	srand(1);
+	game = minesweeper_init_with_options(512, 512, 0.01, 0, large_buffer);
+	srand(1);
+	labelled_game = minesweeper_init_with_options(512, 512, 0.01, MINESWEEPER_LABEL_ZERO_REGIONS, large_labelled_buffer);
+	for (i = 0; i < 10; i++) {
+		x = rand() % 512;
+		y = rand() % 512;
+		if (minesweeper_get_tile_at(game, x, y)->has_mine)
+			continue;
+		minesweeper_open_tile(game, minesweeper_get_tile_at(game, x, y));
+		minesweeper_open_tile(labelled_game, minesweeper_get_tile_at(labelled_game, x, y));
+	}
+	for (i = 0; i < 512 * 512; i++) {
+		mu_assert("Error: large labelled regions must open the same tiles as cascading.", game->tiles[i].is_opened == labelled_game->tiles[i].is_opened);
+	}
+	free(large_buffer);
+	free(large_labelled_buffer);
+
+	/* A region closed again by a rollback opens in bulk again */
+	labelled_game = minesweeper_init_with_options(width, height, 0.0, MINESWEEPER_LABEL_ZERO_REGIONS, labelled_buffer);
+	checkpoint_buffer = malloc(minesweeper_checkpoint_buffer_size(labelled_game, width * height));
+	minesweeper_save_checkpoint(labelled_game, minesweeper_init_checkpoint(labelled_game, width * height, checkpoint_buffer));
+	labelled_game->area_update_callback = &area_callback;
+	labelled_game->user_info = &area_callback_count;
+	area_callback_count = 0;
+	minesweeper_open_tile(labelled_game, minesweeper_get_tile_at(labelled_game, 0, 0));
+	minesweeper_rollback(labelled_game);
+	minesweeper_open_tile(labelled_game, minesweeper_get_tile_at(labelled_game, 5, 5));
+	mu_assert("Error: a rollback must reset which regions are opened.", area_callback_count == 2 && labelled_game->state == MINESWEEPER_WIN);
+	free(checkpoint_buffer);
+	free(tracker_buffer);
+	free(labelled_buffer);
+	return 0;
+}
+
+static unsigned count_mines(struct minesweeper_game *game) {
+	unsigned count = 0, x, y;
+	for (y = 0; y < game->height; y++) {
+		for (x = 0; x < game->width; x++) {
+			if (minesweeper_get_tile_at(game, x, y)->has_mine)
+				count++;
+		}
+	}
+	return count;
+}
+
+static char * test_deferred_generation(void) {
+	uint8_t *deferred_buffer = malloc(minesweeper_buffer_size_with_options(width, height, MINESWEEPER_DEFERRED_GENERATION));
+	unsigned first_clicks[][2] = { { 0, 0 }, { 60, 50 }, { 119, 99 } };
+	unsigned i, x, y;
+
+	puts("Test: Deferred generation...");
+	for (i = 0; i < 3; i++) {
+		unsigned first_x = first_clicks[i][0], first_y = first_clicks[i][1];
+		game = minesweeper_init_with_options(width, height, 0.2, MINESWEEPER_DEFERRED_GENERATION, deferred_buffer);
+		mu_assert("Error: the mine count must be known before mines are placed.", game->mine_count == (unsigned)(width * height * 0.2f));
+		mu_assert("Error: no mines may be placed before the first tile is opened.", count_mines(game) == 0);
+		minesweeper_space_tile(game, minesweeper_get_tile_at(game, 5, 5));
+		mu_assert("Error: flagging a tile must not place the mines.", game->state == MINESWEEPER_PENDING_START && count_mines(game) == 0);
+		minesweeper_space_tile(game, minesweeper_get_tile_at(game, 5, 5));
+
+		minesweeper_open_tile(game, minesweeper_get_tile_at(game, first_x, first_y));
+		mu_assert("Error: exactly the requested number of mines must be placed.", count_mines(game) == (unsigned)(width * height * 0.2f) && game->mine_count == count_mines(game));
+		for (y = first_y > 0 ? first_y - 1 : 0; y <= first_y + 1 && y < (unsigned)height; y++) {
+			for (x = first_x > 0 ? first_x - 1 : 0; x <= first_x + 1 && x < (unsigned)width; x++) {
+				mu_assert("Error: the first tile and its adjacent tiles must not get mines.", !minesweeper_get_tile_at(game, x, y)->has_mine);
+			}
+		}
+		mu_assert("Error: the first tile must start a cascade.", game->opened_tile_count > 1 && game->state == MINESWEEPER_PLAYING);
+	}
+
+	game = minesweeper_init_with_options(width, height, 1.0, MINESWEEPER_DEFERRED_GENERATION, deferred_buffer);
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 0, 0));
+	mu_assert("Error: a full board must get mines everywhere but the first tile and its adjacent tiles.", game->mine_count == (unsigned)(width * height - 4) && count_mines(game) == game->mine_count);
+	mu_assert("Error: the first tiles of a full board must win the game.", game->state == MINESWEEPER_WIN);
+	free(deferred_buffer);
+	return 0;
+}
+
+static void play_random_moves(struct minesweeper_game *game, int count) {
+	int i;
+	for (i = 0; i < count && game->state == MINESWEEPER_PLAYING; i++) {
+		struct minesweeper_tile *tile = minesweeper_get_tile_at(game, rand() % game->width, rand() % game->height);
+		if (i % 3 == 0)
+			minesweeper_toggle_flag(game, tile);
+		else
+			minesweeper_open_tile(game, tile);
+	}
+}
+
+static char * test_checkpoints(void) {
+	unsigned options = MINESWEEPER_TRACK_ADJACENT_FLAGS | MINESWEEPER_LABEL_ZERO_REGIONS;
+	size_t game_size = minesweeper_buffer_size_with_options(width, height, options);
+	uint8_t *checkpoint_game_buffer = malloc(game_size);
+	uint8_t *original = malloc(game_size);
+	uint8_t *inner_original = malloc(game_size);
+	uint8_t *outer_buffer, *inner_buffer;
+	struct minesweeper_checkpoint *outer, *inner;
+	size_t tile_bytes = (size_t)width * height * 2; /* Tiles and their flag counts */
+	unsigned all_pages = (width * height + MINESWEEPER_CHECKPOINT_PAGE_SIZE - 1) / MINESWEEPER_CHECKPOINT_PAGE_SIZE;
+	int callback_count = 0;
+	int i;
+
+	puts("Test: Checkpoints...");
+	srand(3);
+	game = minesweeper_init_with_options(width, height, 0.1, options, checkpoint_game_buffer);
+	game->tile_update_callback = &callback;
+	game->user_info = &callback_count;
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 10, 10));
+	memcpy(original, game, game_size);
+	minesweeper_release_checkpoint(game);
+	mu_assert("Error: rolling back without a checkpoint must fail.", !minesweeper_rollback(game));
+	mu_assert("Error: rolling back or releasing without a checkpoint must not change the game.", memcmp(original, game, game_size) == 0);
+	outer_buffer = malloc(minesweeper_checkpoint_buffer_size(game, all_pages));
+	inner_buffer = malloc(minesweeper_checkpoint_buffer_size(game, all_pages));
+	outer = minesweeper_init_checkpoint(game, all_pages, outer_buffer);
+	inner = minesweeper_init_checkpoint(game, all_pages, inner_buffer);
+
+	memcpy(original, game, game_size);
+	minesweeper_save_checkpoint(game, outer);
+	for (i = 0; i < 3; i++) {
+		play_random_moves(game, 20);
+		callback_count = 0;
+		mu_assert("Error: a checkpoint with room for every page must roll back.", minesweeper_rollback(game));
+		mu_assert("Error: rolling back must restore every tile.", memcmp(game->tiles, ((struct minesweeper_game *)original)->tiles, tile_bytes) == 0);
+		mu_assert("Error: rolling back must restore the counters.", game->opened_tile_count == ((struct minesweeper_game *)original)->opened_tile_count && game->flag_count == 0 && game->state == MINESWEEPER_PLAYING);
+		mu_assert("Error: rolling back must send callbacks for tiles that changed.", i > 0 || callback_count > 0);
+	}
+
+	play_random_moves(game, 5);
+	memcpy(inner_original, game, game_size);
+	minesweeper_save_checkpoint(game, inner);
+	play_random_moves(game, 20);
+	mu_assert("Error: nested checkpoints must roll back.", minesweeper_rollback(game));
+	mu_assert("Error: a nested checkpoint must restore its own state.", memcmp(game->tiles, ((struct minesweeper_game *)inner_original)->tiles, tile_bytes) == 0);
+	play_random_moves(game, 20);
+	minesweeper_release_checkpoint(game);
+	mu_assert("Error: releasing a checkpoint must make the previous one the newest.", game->checkpoint == outer);
+	mu_assert("Error: rolling back past a released checkpoint must work.", minesweeper_rollback(game));
+	mu_assert("Error: changes from a released checkpoint must be rolled back too.", memcmp(game->tiles, ((struct minesweeper_game *)original)->tiles, tile_bytes) == 0);
+	minesweeper_release_checkpoint(game);
+	mu_assert("Error: releasing the last checkpoint must stop saving pages.", game->checkpoint == NULL);
+
+	free(inner_buffer);
+	inner_buffer = malloc(minesweeper_checkpoint_buffer_size(game, 1));
+	inner = minesweeper_init_checkpoint(game, 1, inner_buffer);
+	minesweeper_save_checkpoint(game, inner);
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 0, 0));
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, width - 1, height - 1));
+	mu_assert("Error: a checkpoint that ran out of pages must not roll back.", !minesweeper_rollback(game) && inner->overflowed);
+	minesweeper_release_checkpoint(game);
+
+	free(outer_buffer);
+	free(inner_buffer);
+	free(inner_original);
+	free(original);
+	free(checkpoint_game_buffer);
+	return 0;
+}
+
+static char * test_batched_actions(void) {
+	uint8_t *tracker_buffer = malloc(minesweeper_change_tracker_buffer_size(width, height));
+	struct minesweeper_action actions[] = {
+		{ MINESWEEPER_ACTION_TOGGLE_FLAG, 0, 0 },
+		{ MINESWEEPER_ACTION_OPEN, 50, 50 },
+		{ MINESWEEPER_ACTION_OPEN, 500, 50 },
+		{ (enum minesweeper_action_type)7, 50, 50 },
+		{ MINESWEEPER_ACTION_OPEN, 50, 50 },
+		{ MINESWEEPER_ACTION_OPEN, 3, 3 },
+		{ MINESWEEPER_ACTION_SPACE, 0, 0 }
+	};
+	enum minesweeper_action_result results[7];
+	int callback_count = 0;
+
+	puts("Test: Batched actions...");
+	game = minesweeper_init(width, height, 0.0, game_buffer);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 3, 3));
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 2, 2));
+	minesweeper_track_changes(game, tracker_buffer);
+	game->tile_update_callback = &callback;
+	game->area_update_callback = &area_callback;
+	game->user_info = &callback_count;
+
+	mu_assert("Error: the number of actions that changed the game must be returned.", minesweeper_apply_actions(game, actions, 7, results) == 3);
+	mu_assert("Error: valid actions must be applied.", results[0] == MINESWEEPER_ACTION_APPLIED && results[1] == MINESWEEPER_ACTION_APPLIED && minesweeper_get_tile_at(game, 0, 0)->has_flag);
+	mu_assert("Error: out of bounds actions must be rejected.", results[2] == MINESWEEPER_ACTION_OUT_OF_BOUNDS);
+	mu_assert("Error: unknown actions must be rejected.", results[3] == MINESWEEPER_ACTION_INVALID_TYPE);
+	mu_assert("Error: actions that change nothing must be reported.", results[4] == MINESWEEPER_ACTION_NO_CHANGE);
+	mu_assert("Error: opening a mine must end the game.", results[5] == MINESWEEPER_ACTION_APPLIED && game->state == MINESWEEPER_GAME_OVER);
+	mu_assert("Error: actions after the game ended must be skipped.", results[6] == MINESWEEPER_ACTION_SKIPPED && minesweeper_get_tile_at(game, 0, 0)->has_flag);
+	mu_assert("Error: a batch must be reported as a single changed area.", callback_count == 1 && game->tile_update_callback == &callback && game->user_info == &callback_count);
+	mu_assert("Error: all changed tiles must be recorded in one change set.", game->change_tracker->changed_tile_count == game->opened_tile_count + 1);
+
+	/* Without an area callback, every changed tile is reported */
+	game = minesweeper_init(width, height, 0.0, game_buffer);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 3, 3));
+	game->tile_update_callback = &callback;
+	game->user_info = &callback_count;
+	callback_count = 0;
+	mu_assert("Error: batches must be applied without results.", minesweeper_apply_actions(game, actions, 2, NULL) == 2);
+	mu_assert("Error: a callback must be sent for every tile changed by a batch.", callback_count == (int)game->opened_tile_count + 1);
+
+	game->change_tracker = NULL;
+	free(tracker_buffer);
+	return 0;
+}
+
+#define EXPERT_WIDTH 30
+#define EXPERT_HEIGHT 16
+#define EXPERT_DENSITY (99.0f / (EXPERT_WIDTH * EXPERT_HEIGHT))
+
+/**
+ * Play a seeded expert game to a win by opening every tile without a
+ * mine, and record it in replay. Returns the number of actions.
+ */
+static size_t record_winning_replay(uint32_t seed, uint8_t *buffer, struct minesweeper_replay *replay, struct minesweeper_action *actions, uint32_t *timestamps) {
+	struct minesweeper_game *game = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, MINESWEEPER_DEFERRED_GENERATION, seed, buffer);
+	size_t count = 0;
+	unsigned x, y;
+	for (y = 0; y < EXPERT_HEIGHT; y++) {
+		for (x = 0; x < EXPERT_WIDTH && game->state != MINESWEEPER_WIN; x++) {
+			struct minesweeper_tile *tile = minesweeper_get_tile_at(game, x, y);
+			if (tile->is_opened || tile->has_mine)
+				continue;
+			actions[count].type = MINESWEEPER_ACTION_OPEN;
+			actions[count].x = x;
+			actions[count].y = y;
+			timestamps[count] = 1000 + count * 250;
+			count++;
+			minesweeper_open_tile(game, tile);
+		}
+	}
+	replay->width = EXPERT_WIDTH;
+	replay->height = EXPERT_HEIGHT;
+	replay->mine_density = EXPERT_DENSITY;
+	replay->options = MINESWEEPER_DEFERRED_GENERATION;
+	replay->seed = seed;
+	replay->actions = actions;
+	replay->timestamps = timestamps;
+	replay->action_count = count;
+	replay->claimed_state = game->state;
+	replay->claimed_time = timestamps[count - 1] - timestamps[0];
+	return count;
+}
+
+static char * test_metrics(void) {
+	uint8_t *small_buffer = malloc(minesweeper_minimum_buffer_size(7, 5));
+	uint8_t *metrics_buffer = malloc(minesweeper_metrics_buffer_size(width));
+	uint8_t *buffers[8];
+	struct minesweeper_game *games[8];
+	struct minesweeper_metrics metrics, batch_metrics[8];
+	unsigned i;
+
+	puts("Test: Board metrics...");
+	/* A column of mines splits the board into two openings */
+	game = minesweeper_init(5, 5, 0.0, small_buffer);
+	for (i = 0; i < 5; i++) {
+		minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 2, i));
+	}
+	minesweeper_compute_metrics(game, &metrics, metrics_buffer);
+	mu_assert("Error: a column of mines must leave two openings.", metrics.openings == 2 && metrics.isolated_numbers == 0 && metrics.bbbv == 2);
+
+	/* A single mine in the middle leaves only numbers */
+	game = minesweeper_init(3, 3, 0.0, small_buffer);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 1, 1));
+	minesweeper_compute_metrics(game, &metrics, metrics_buffer);
+	mu_assert("Error: numbers without openings must all be isolated.", metrics.openings == 0 && metrics.isolated_numbers == 8 && metrics.bbbv == 8);
+
+	/* Two openings on either side of a mine, which join in a later row */
+	game = minesweeper_init(7, 3, 0.0, small_buffer);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 3, 0));
+	minesweeper_compute_metrics(game, &metrics, metrics_buffer);
+	mu_assert("Error: openings joined in a later row must be counted once.", metrics.openings == 1 && metrics.bbbv == 1);
+
+	for (i = 0; i < 8; i++) {
+		unsigned options = i % 2 ? MINESWEEPER_TRACK_ADJACENT_FLAGS : 0;
+		buffers[i] = malloc(minesweeper_buffer_size_with_options(width, height, options));
+		games[i] = minesweeper_init_with_seed(width, height, 0.1f + 0.02f * (i / 2), options, i / 2, buffers[i]);
+	}
+	mu_assert("Error: metrics must be computed on several threads.", minesweeper_compute_metrics_parallel(games, 8, batch_metrics, 3));
+	for (i = 0; i < 8; i++) {
+		minesweeper_compute_metrics(games[i], &metrics, metrics_buffer);
+		mu_assert("Error: computing on several threads must give the same metrics.", memcmp(&metrics, &batch_metrics[i], sizeof(metrics)) == 0);
+		mu_assert("Error: tracking flag counts must not affect the metrics.", i % 2 == 0 || memcmp(&batch_metrics[i - 1], &batch_metrics[i], sizeof(metrics)) == 0);
+		mu_assert("Error: 3BV must add up.", metrics.bbbv == metrics.openings + metrics.isolated_numbers && metrics.openings > 1);
+		free(buffers[i]);
+	}
+
+	free(metrics_buffer);
+	free(small_buffer);
+	return 0;
+}
+
+static char * test_hints(void) {
+	unsigned options = MINESWEEPER_DEFERRED_GENERATION | MINESWEEPER_LABEL_ZERO_REGIONS;
+	uint8_t *hint_game_buffer = malloc(minesweeper_buffer_size_with_options(EXPERT_WIDTH, EXPERT_HEIGHT, options));
+	uint8_t *cache_buffer = malloc(minesweeper_hint_cache_buffer_size(EXPERT_WIDTH, EXPERT_HEIGHT));
+	uint8_t *fresh_cache_buffer = malloc(minesweeper_hint_cache_buffer_size(EXPERT_WIDTH, EXPERT_HEIGHT));
+	uint8_t *checkpoint_buffer;
+	struct minesweeper_hint_cache *cache;
+	struct minesweeper_checkpoint *checkpoint;
+	struct minesweeper_hint hint, again, fresh;
+	unsigned seed, safe_hint_count = 0;
+
+	puts("Test: Hints...");
+	for (seed = 0; seed < 20; seed++) {
+		game = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, options, seed, hint_game_buffer);
+		cache = minesweeper_cache_hints(game, cache_buffer);
+		mu_assert("Error: there must be a hint before the first move.", minesweeper_get_hint(game, &hint) && hint.is_safe);
+		while (minesweeper_get_hint(game, &hint)) {
+			mu_assert("Error: a hint must be an unopened tile without a flag.", !minesweeper_get_tile_at(game, hint.x, hint.y)->is_opened && !minesweeper_get_tile_at(game, hint.x, hint.y)->has_flag);
+			mu_assert("Error: a hint must be cached while nothing changes.", cache->has_hint && minesweeper_get_hint(game, &again) && memcmp(&hint, &again, sizeof(hint)) == 0);
+
+			/* Deductions kept since earlier moves must match deducing everything again */
+			minesweeper_cache_hints(game, fresh_cache_buffer);
+			mu_assert("Error: a fresh cache must find a hint too.", minesweeper_get_hint(game, &fresh));
+			mu_assert("Error: updated deductions must match fresh ones.", fresh.is_safe == hint.is_safe);
+			mu_assert("Error: updated guesses must match fresh ones.", hint.is_safe || (fresh.x == hint.x && fresh.y == hint.y && fresh.mine_probability == hint.mine_probability));
+			game->hint_cache = cache;
+
+			if (hint.is_safe) {
+				safe_hint_count++;
+				mu_assert("Error: a safe hint must not have a mine.", !minesweeper_get_tile_at(game, hint.x, hint.y)->has_mine);
+			}
+			minesweeper_open_tile(game, minesweeper_get_tile_at(game, hint.x, hint.y));
+		}
+	}
+	mu_assert("Error: hints must find safe tiles.", safe_hint_count > 20 * 10);
+
+	/* Closing tiles again by rolling back must not leave stale deductions */
+	game = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, options, 1, hint_game_buffer);
+	cache = minesweeper_cache_hints(game, cache_buffer);
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 15, 8));
+	checkpoint_buffer = malloc(minesweeper_checkpoint_buffer_size(game, 64));
+	checkpoint = minesweeper_init_checkpoint(game, 64, checkpoint_buffer);
+	mu_assert("Error: there must be a hint after the first move.", minesweeper_get_hint(game, &hint));
+	minesweeper_save_checkpoint(game, checkpoint);
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, hint.x, hint.y));
+	minesweeper_rollback(game);
+	mu_assert("Error: rolling back must bring back the earlier hint.", minesweeper_get_hint(game, &again) && memcmp(&hint, &again, sizeof(hint)) == 0);
+	minesweeper_release_checkpoint(game);
+
+	free(checkpoint_buffer);
+	free(fresh_cache_buffer);
+	free(cache_buffer);
+	free(hint_game_buffer);
+	return 0;
+}
+
+/**
+ * Jump from random tiles with and without the cursor index,
+ * returning false if they ever end up somewhere else.
+ */
+static bool cursor_index_matches_scan(struct minesweeper_game *game) {
+	struct minesweeper_cursor_index *index = game->cursor_index;
+	int i, kind, option;
+	for (i = 0; i < 100; i++) {
+		unsigned x = rand() % game->width, y = rand() % game->height;
+		for (kind = 0; kind < MINESWEEPER_TILE_KIND_COUNT; kind++) {
+			for (option = 0; option < 8; option++) {
+				struct minesweeper_tile *indexed_tile;
+				bool indexed_result, scanned_result;
+				game->cursor_index = index;
+				minesweeper_set_cursor(game, x, y);
+				indexed_result = option < 4 ? minesweeper_jump_cursor(game, kind, option & 1, option & 2) : minesweeper_jump_cursor_in_direction(game, kind, option - 4);
+				indexed_tile = game->selected_tile;
+				game->cursor_index = NULL;
+				minesweeper_set_cursor(game, x, y);
+				scanned_result = option < 4 ? minesweeper_jump_cursor(game, kind, option & 1, option & 2) : minesweeper_jump_cursor_in_direction(game, kind, option - 4);
+				if (indexed_result != scanned_result || indexed_tile != game->selected_tile) {
+					game->cursor_index = index;
+					return false;
+				}
+			}
+		}
+	}
+	game->cursor_index = index;
+	return true;
+}
+
+static char * test_cursor_jumps(void) {
+	uint8_t *jump_game_buffer = malloc(minesweeper_buffer_size_with_options(width, height, MINESWEEPER_LABEL_ZERO_REGIONS));
+	uint8_t *index_buffer = malloc(minesweeper_cursor_index_buffer_size(width, height));
+	uint8_t *checkpoint_buffer;
+	struct minesweeper_checkpoint *checkpoint;
+	int i;
+
+	puts("Test: Cursor jumps...");
+	/* Leaves (0, 0), a flag at (1, 0) and a mine at (0, 1) unopened */
+	game = minesweeper_init_with_seed(4, 2, 0.0, 0, 1, jump_game_buffer);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 0, 1));
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 1, 0));
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 3, 1));
+	minesweeper_index_cursor_jumps(game, index_buffer);
+	mu_assert("Error: jumping without a cursor must start from the first tile.", minesweeper_jump_cursor(game, MINESWEEPER_UNFLAGGED_TILE, false, false) && game->selected_tile == minesweeper_get_tile_at(game, 0, 0));
+	mu_assert("Error: must jump to the next unopened tile.", minesweeper_jump_cursor(game, MINESWEEPER_UNOPENED_TILE, false, false) && game->selected_tile == minesweeper_get_tile_at(game, 1, 0));
+	mu_assert("Error: must skip flagged tiles.", minesweeper_jump_cursor(game, MINESWEEPER_UNFLAGGED_TILE, false, false) && game->selected_tile == minesweeper_get_tile_at(game, 0, 1));
+	mu_assert("Error: must not move past the last tile without wrapping.", !minesweeper_jump_cursor(game, MINESWEEPER_FRONTIER_TILE, false, false) && game->selected_tile == minesweeper_get_tile_at(game, 0, 1));
+	mu_assert("Error: must continue from the first tile when wrapping.", minesweeper_jump_cursor(game, MINESWEEPER_FRONTIER_TILE, false, true) && game->selected_tile == minesweeper_get_tile_at(game, 0, 0));
+	mu_assert("Error: must jump to the previous tile when going backwards.", minesweeper_jump_cursor(game, MINESWEEPER_UNOPENED_TILE, true, true) && game->selected_tile == minesweeper_get_tile_at(game, 0, 1));
+	minesweeper_set_cursor(game, 3, 0);
+	mu_assert("Error: must jump to the nearest tile on the left.", minesweeper_jump_cursor_in_direction(game, MINESWEEPER_UNOPENED_TILE, LEFT) && game->selected_tile == minesweeper_get_tile_at(game, 1, 0));
+	mu_assert("Error: must not jump without a tile below.", !minesweeper_jump_cursor_in_direction(game, MINESWEEPER_UNOPENED_TILE, DOWN));
+	minesweeper_set_cursor(game, 0, 0);
+	mu_assert("Error: must jump to the nearest tile below.", minesweeper_jump_cursor_in_direction(game, MINESWEEPER_UNOPENED_TILE, DOWN) && game->selected_tile == minesweeper_get_tile_at(game, 0, 1));
+
+	srand(4);
+	game = minesweeper_init_with_options(width, height, 0.1, MINESWEEPER_LABEL_ZERO_REGIONS, jump_game_buffer);
+	minesweeper_index_cursor_jumps(game, index_buffer);
+	mu_assert("Error: jumps on an unopened board must match scanning.", cursor_index_matches_scan(game));
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 10, 10));
+	mu_assert("Error: jumps after a cascade must match scanning.", cursor_index_matches_scan(game));
+
+	checkpoint_buffer = malloc(minesweeper_checkpoint_buffer_size(game, width * height));
+	checkpoint = minesweeper_init_checkpoint(game, width * height, checkpoint_buffer);
+	for (i = 0; i < 3; i++) {
+		minesweeper_save_checkpoint(game, checkpoint);
+		play_random_moves(game, 30);
+		mu_assert("Error: jumps after random moves must match scanning.", cursor_index_matches_scan(game));
+		minesweeper_rollback(game);
+		minesweeper_release_checkpoint(game);
+		mu_assert("Error: jumps after rolling back must match scanning.", cursor_index_matches_scan(game));
+	}
+
+	free(checkpoint_buffer);
+	free(index_buffer);
+	free(jump_game_buffer);
+	return 0;
+}
+
+/**
+ * Opens the same tiles as a cascade from (x, y) should, by flooding
+ * through minesweeper_get_adjacent_tiles(), and compares them with the
+ * opened tiles of game.
+ */
+static bool cascade_matches_flood(struct minesweeper_game *game, unsigned x, unsigned y) {
+	size_t tile_count = (size_t)game->width * game->height, stack_size = 0, i;
+	bool *expected = calloc(tile_count, sizeof(bool));
+	struct minesweeper_tile **stack = malloc(tile_count * sizeof(struct minesweeper_tile *));
+	struct minesweeper_tile *adjacent_tiles[8];
+	bool matches = true;
+	int j;
+
+	expected[(size_t)y * game->width + x] = true;
+	stack[stack_size++] = minesweeper_get_tile_at(game, x, y);
+	while (stack_size > 0) {
+		struct minesweeper_tile *tile = stack[--stack_size];
+		if (tile->adjacent_mine_count > 0)
+			continue;
+		minesweeper_get_adjacent_tiles(game, tile, adjacent_tiles);
+		for (j = 0; j < 8; j++) {
+			unsigned ax, ay;
+			if (adjacent_tiles[j] == NULL || adjacent_tiles[j]->has_flag)
+				continue;
+			minesweeper_get_tile_location(game, adjacent_tiles[j], &ax, &ay);
+			if (!expected[(size_t)ay * game->width + ax]) {
+				expected[(size_t)ay * game->width + ax] = true;
+				stack[stack_size++] = adjacent_tiles[j];
+			}
+		}
+	}
+	for (i = 0; i < tile_count; i++) {
+		if (minesweeper_get_tile_at(game, i % game->width, i / game->width)->is_opened != expected[i])
+			matches = false;
+	}
+	free(stack);
+	free(expected);
+	return matches;
+}
+
+static char * test_topologies(void) {
+	unsigned options[] = { MINESWEEPER_TORUS, MINESWEEPER_HEX, MINESWEEPER_TORUS | MINESWEEPER_HEX, MINESWEEPER_TORUS | MINESWEEPER_TRACK_ADJACENT_FLAGS };
+	unsigned all_options = MINESWEEPER_TORUS | MINESWEEPER_HEX | MINESWEEPER_TRACK_ADJACENT_FLAGS | MINESWEEPER_DEFERRED_GENERATION;
+	uint8_t *topology_buffer = malloc(minesweeper_buffer_size_with_options(width, height, all_options));
+	uint8_t *index_buffer = malloc(minesweeper_cursor_index_buffer_size(width, height));
+	uint8_t *hint_buffer = malloc(minesweeper_hint_cache_buffer_size(width, height));
+	uint8_t *metrics_buffer = malloc(minesweeper_metrics_buffer_size(width));
+	struct minesweeper_tile *adjacent_tiles[8];
+	struct minesweeper_hint hint;
+	struct minesweeper_metrics metrics;
+	unsigned i, x, y;
+
+	puts("Test: Torus and hexagonal topologies...");
+	game = minesweeper_init_with_options(10, 10, 0.0, MINESWEEPER_TORUS, topology_buffer);
+	minesweeper_get_adjacent_tiles(game, minesweeper_get_tile_at(game, 0, 0), adjacent_tiles);
+	mu_assert("Error: a corner tile on a torus should have 8 adjacent tiles.", count_adjacent_tiles(adjacent_tiles) == 8);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 9, 9));
+	mu_assert("Error: mines must be counted across the edges of a torus.", minesweeper_get_tile_at(game, 0, 0)->adjacent_mine_count == 1);
+	minesweeper_set_cursor(game, 0, 0);
+	minesweeper_move_cursor(game, LEFT, false);
+	mu_assert("Error: the cursor must always wrap on a torus.", game->selected_tile == minesweeper_get_tile_at(game, 9, 0));
+
+	game = minesweeper_init_with_options(10, 10, 0.0, MINESWEEPER_HEX, topology_buffer);
+	minesweeper_get_adjacent_tiles(game, minesweeper_get_tile_at(game, 5, 4), adjacent_tiles);
+	mu_assert("Error: a hexagonal tile should have 6 adjacent tiles.", count_adjacent_tiles(adjacent_tiles) == 6);
+	mu_assert("Error: the tiles above an even row must be on the left.", adjacent_tiles[0] == minesweeper_get_tile_at(game, 4, 3) && adjacent_tiles[1] == minesweeper_get_tile_at(game, 5, 3));
+	minesweeper_get_adjacent_tiles(game, minesweeper_get_tile_at(game, 0, 0), adjacent_tiles);
+	mu_assert("Error: the hexagonal tile at (0, 0) should have 2 adjacent tiles.", count_adjacent_tiles(adjacent_tiles) == 2);
+	minesweeper_get_adjacent_tiles(game, minesweeper_get_tile_at(game, 0, 1), adjacent_tiles);
+	mu_assert("Error: the hexagonal tile at (0, 1) should have 5 adjacent tiles.", count_adjacent_tiles(adjacent_tiles) == 5);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 4, 4));
+	mu_assert("Error: a hexagonal tile must not count mines it isn't adjacent to.", minesweeper_get_tile_at(game, 5, 5)->adjacent_mine_count == 0 && minesweeper_get_tile_at(game, 4, 5)->adjacent_mine_count == 1);
+
+	game = minesweeper_init_with_options(10, 10, 0.0, MINESWEEPER_TORUS | MINESWEEPER_HEX, topology_buffer);
+	for (i = 0; i < 100; i++) {
+		minesweeper_get_adjacent_tiles(game, minesweeper_get_tile_at(game, i % 10, i / 10), adjacent_tiles);
+		mu_assert("Error: every hexagonal tile on a torus should have 6 adjacent tiles.", count_adjacent_tiles(adjacent_tiles) == 6);
+	}
+	mu_assert("Error: a hexagonal torus must not have an odd height.", minesweeper_init_with_options(10, 9, 0.0, MINESWEEPER_TORUS | MINESWEEPER_HEX, topology_buffer) == NULL);
+	mu_assert("Error: a torus must not be narrower than 3 tiles.", minesweeper_init_with_options(2, 10, 0.0, MINESWEEPER_TORUS, topology_buffer) == NULL);
+	mu_assert("Error: a torus must not be lower than 3 tiles.", minesweeper_init_with_options(10, 2, 0.0, MINESWEEPER_TORUS, topology_buffer) == NULL);
+	game = minesweeper_init_with_options(3, 3, 0.0, MINESWEEPER_TORUS, topology_buffer);
+	mu_assert("Error: a 3x3 torus must be allowed.", game != NULL);
+	mu_assert("Error: metrics must not be computed on a torus.", !minesweeper_compute_metrics(game, &metrics, metrics_buffer));
+	mu_assert("Error: metrics must not be computed on a torus on several threads.", !minesweeper_compute_metrics_parallel(&game, 1, &metrics, 1));
+
+	for (i = 0; i < 8; i++) {
+		unsigned option = options[i % 4];
+		game = minesweeper_init_with_seed(width, height, 0.12, option, i, topology_buffer);
+		minesweeper_index_cursor_jumps(game, index_buffer);
+		minesweeper_cache_hints(game, hint_buffer);
+		for (y = 0; y < (unsigned)height; y++) {
+			for (x = 0; x < (unsigned)width; x++) {
+				if (minesweeper_get_tile_at(game, x, y)->adjacent_mine_count == 0 && !minesweeper_get_tile_at(game, x, y)->has_mine)
+					break;
+			}
+			if (x < (unsigned)width)
+				break;
+		}
+		mu_assert("Error: the test board should have a tile without adjacent mines.", y < (unsigned)height);
+		if (i < 4)
+			minesweeper_open_tile(game, minesweeper_get_tile_at(game, x, y));
+		else
+			minesweeper_open_tile_parallel(game, minesweeper_get_tile_at(game, x, y), 4);
+		mu_assert("Error: a cascade must open the tiles adjacent to tiles without adjacent mines.", cascade_matches_flood(game, x, y));
+		mu_assert("Error: jumps on a torus or hexagonal board must match scanning.", cursor_index_matches_scan(game));
+		while (minesweeper_get_hint(game, &hint) && hint.is_safe) {
+			struct minesweeper_tile *tile = minesweeper_get_tile_at(game, hint.x, hint.y);
+			mu_assert("Error: safe hints must follow the topology.", !tile->has_mine);
+			minesweeper_open_tile(game, tile);
+		}
+	}
+
+	for (i = 0; i < 3; i++) {
+		struct minesweeper_tile *first_tile;
+		int j;
+		game = minesweeper_init_with_options(width, height, 0.5, options[i] | MINESWEEPER_DEFERRED_GENERATION, topology_buffer);
+		first_tile = minesweeper_get_tile_at(game, 0, 0);
+		minesweeper_open_tile(game, first_tile);
+		minesweeper_get_adjacent_tiles(game, first_tile, adjacent_tiles);
+		mu_assert("Error: the first tile must not get a mine.", !first_tile->has_mine && first_tile->adjacent_mine_count == 0);
+		for (j = 0; j < 8; j++) {
+			mu_assert("Error: the tiles adjacent to the first tile must not get mines.", adjacent_tiles[j] == NULL || !adjacent_tiles[j]->has_mine);
+		}
+		mu_assert("Error: exactly the requested number of mines must be placed.", count_mines(game) == game->mine_count && game->mine_count == (unsigned)(width * height * 0.5f));
+	}
+
+	free(metrics_buffer);
+	free(hint_buffer);
+	free(index_buffer);
+	free(topology_buffer);
+	return 0;
+}
+
+static char * test_zobrist_hashes(void) {
+	unsigned options[] = { 0, MINESWEEPER_TRACK_ADJACENT_FLAGS, MINESWEEPER_LABEL_ZERO_REGIONS };
+	size_t size = minesweeper_buffer_size_with_options(width, height, MINESWEEPER_TRACK_ADJACENT_FLAGS | MINESWEEPER_LABEL_ZERO_REGIONS);
+	uint8_t *hash_buffer = malloc(size), *other_buffer = malloc(size);
+	uint8_t *checkpoint_buffer;
+	struct minesweeper_game *other;
+	struct minesweeper_checkpoint *checkpoint;
+	uint64_t mine_hash, visible_hash;
+	int i;
+
+	puts("Test: Zobrist hashes...");
+	game = minesweeper_init_with_seed(width, height, 0.05, 0, 7, hash_buffer);
+	other = minesweeper_init_with_seed(width, height, 0.05, 0, 8, other_buffer);
+	mine_hash = game->mine_hash;
+	mu_assert("Error: an unopened board must have an empty visible hash.", game->visible_hash == 0 && mine_hash != 0);
+	mu_assert("Error: different boards must have different hashes.", mine_hash != other->mine_hash);
+
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 1, 1));
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 2, 2));
+	minesweeper_toggle_flag(other, minesweeper_get_tile_at(other, 2, 2));
+	minesweeper_toggle_flag(other, minesweeper_get_tile_at(other, 1, 1));
+	mu_assert("Error: the visible hash must not depend on the order of moves.", game->visible_hash != 0 && game->visible_hash == other->visible_hash);
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 1, 1));
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 2, 2));
+	mu_assert("Error: removing flags must restore the visible hash.", game->visible_hash == 0);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 3, 3));
+	mu_assert("Error: moving a mine must change the mine hash.", game->mine_hash != mine_hash);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 3, 3));
+	mu_assert("Error: moving a mine back must restore the mine hash.", game->mine_hash == mine_hash);
+
+	/* The same cascade must give the same hashes, however its tiles are opened */
+	other = minesweeper_init_with_seed(width, height, 0.05, 0, 7, other_buffer);
+	minesweeper_open_tile(other, minesweeper_get_tile_at(other, 60, 50));
+	for (i = 0; i < 4; i++) {
+		game = minesweeper_init_with_seed(width, height, 0.05, options[i % 3], 7, hash_buffer);
+		if (i < 3)
+			minesweeper_open_tile(game, minesweeper_get_tile_at(game, 60, 50));
+		else
+			minesweeper_open_tile_parallel(game, minesweeper_get_tile_at(game, 60, 50), 4);
+		mu_assert("Error: options must not change the mine hash.", game->mine_hash == other->mine_hash);
+		mu_assert("Error: the way tiles are opened must not change the visible hash.", game->opened_tile_count > 1 && game->visible_hash == other->visible_hash);
+	}
+
+	checkpoint_buffer = malloc(minesweeper_checkpoint_buffer_size(game, width * height));
+	checkpoint = minesweeper_init_checkpoint(game, width * height, checkpoint_buffer);
+	mine_hash = game->mine_hash;
+	visible_hash = game->visible_hash;
+	minesweeper_save_checkpoint(game, checkpoint);
+	play_random_moves(game, 30);
+	mu_assert("Error: moves must change the visible hash.", game->visible_hash != visible_hash);
+	minesweeper_rollback(game);
+	minesweeper_release_checkpoint(game);
+	mu_assert("Error: rolling back must restore the hashes.", game->mine_hash == mine_hash && game->visible_hash == visible_hash);
+
+	free(checkpoint_buffer);
+	free(other_buffer);
+	free(hash_buffer);
+	return 0;
+}
+
+/**
+ * Counts the tiles of every cell of every level of the overview from
+ * scratch, and compares them with the overview.
+ */
+static bool overview_matches_tiles(struct minesweeper_game *game) {
+	unsigned level, cell_width, cell_height, cell_x, cell_y, x, y;
+	for (level = 0; level < game->overview->level_count; level++) {
+		const struct minesweeper_tile_counts *cells = minesweeper_get_overview(game, level, &cell_width, &cell_height);
+		unsigned size = MINESWEEPER_OVERVIEW_BLOCK_SIZE << level;
+		for (cell_y = 0; cell_y < cell_height; cell_y++) {
+			for (cell_x = 0; cell_x < cell_width; cell_x++) {
+				struct minesweeper_tile_counts counts = { 0, 0, 0 };
+				const struct minesweeper_tile_counts *cell = &cells[cell_y * cell_width + cell_x];
+				for (y = cell_y * size; y < (cell_y + 1) * size && y < game->height; y++) {
+					for (x = cell_x * size; x < (cell_x + 1) * size && x < game->width; x++) {
+						struct minesweeper_tile *tile = minesweeper_get_tile_at(game, x, y);
+						counts.opened += tile->is_opened;
+						counts.flagged += tile->has_flag;
+						counts.revealed_mines += tile->is_opened && tile->has_mine;
+					}
+				}
+				if (counts.opened != cell->opened || counts.flagged != cell->flagged || counts.revealed_mines != cell->revealed_mines)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+static char * test_overview(void) {
+	unsigned options[] = { 0, MINESWEEPER_TRACK_ADJACENT_FLAGS, MINESWEEPER_LABEL_ZERO_REGIONS };
+	uint8_t *overview_game_buffer = malloc(minesweeper_buffer_size_with_options(width, height, MINESWEEPER_TRACK_ADJACENT_FLAGS | MINESWEEPER_LABEL_ZERO_REGIONS));
+	uint8_t *overview_buffer = malloc(minesweeper_overview_buffer_size(width, height));
+	uint8_t *checkpoint_buffer;
+	struct minesweeper_checkpoint *checkpoint;
+	const struct minesweeper_tile_counts *cells;
+	unsigned cell_width, cell_height, i;
+
+	puts("Test: Overview...");
+	game = minesweeper_init_with_seed(width, height, 0.05, 0, 3, overview_game_buffer);
+	minesweeper_track_overview(game, overview_buffer);
+	mu_assert("Error: level 0 must have a cell per block.", game->overview->level_widths[0] == (unsigned)(width + 7) / 8 && game->overview->level_heights[0] == (unsigned)(height + 7) / 8);
+	cells = minesweeper_get_overview(game, game->overview->level_count - 1, &cell_width, &cell_height);
+	mu_assert("Error: the top level must have a single cell.", cells != NULL && cell_width == 1 && cell_height == 1);
+	mu_assert("Error: there must be no level above the top level.", minesweeper_get_overview(game, game->overview->level_count, &cell_width, &cell_height) == NULL);
+	mu_assert("Error: the most detailed level that fits must be picked.", minesweeper_overview_level_for_size(game, 8, 8) == 1 && minesweeper_overview_level_for_size(game, 1000, 1000) == 0);
+	mu_assert("Error: a new overview must match the tiles.", overview_matches_tiles(game));
+
+	for (i = 0; i < 4; i++) {
+		game = minesweeper_init_with_seed(width, height, 0.05, options[i % 3], 3, overview_game_buffer);
+		minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 1, 1));
+		minesweeper_track_overview(game, overview_buffer);
+		if (i < 3)
+			minesweeper_open_tile(game, minesweeper_get_tile_at(game, 60, 50));
+		else
+			minesweeper_open_tile_parallel(game, minesweeper_get_tile_at(game, 60, 50), 4);
+		mu_assert("Error: the overview must match the tiles after a cascade.", game->opened_tile_count > 1 && overview_matches_tiles(game));
+		cells = minesweeper_get_overview(game, game->overview->level_count - 1, &cell_width, &cell_height);
+		mu_assert("Error: the top level must count the whole board.", cells[0].opened == game->opened_tile_count && cells[0].flagged == game->flag_count);
+	}
+
+	checkpoint_buffer = malloc(minesweeper_checkpoint_buffer_size(game, width * height));
+	checkpoint = minesweeper_init_checkpoint(game, width * height, checkpoint_buffer);
+	for (i = 0; i < 3; i++) {
+		minesweeper_save_checkpoint(game, checkpoint);
+		play_random_moves(game, 30);
+		mu_assert("Error: the overview must match the tiles after random moves.", overview_matches_tiles(game));
+		minesweeper_rollback(game);
+		minesweeper_release_checkpoint(game);
+		mu_assert("Error: the overview must match the tiles after rolling back.", overview_matches_tiles(game));
+	}
+
+	game = minesweeper_init_with_options(10, 10, 0.0, 0, overview_game_buffer);
+	minesweeper_track_overview(game, overview_buffer);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 9, 9));
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 9, 9));
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 9, 9));
+	mu_assert("Error: moving a revealed mine must update the overview.", overview_matches_tiles(game));
+
+	free(checkpoint_buffer);
+	free(overview_buffer);
+	free(overview_game_buffer);
+	return 0;
+}
+
+static unsigned count_opened_tiles(struct minesweeper_game *game) {
+	unsigned count = 0, x, y;
+	for (y = 0; y < game->height; y++) {
+		for (x = 0; x < game->width; x++) {
+			count += minesweeper_get_tile_at(game, x, y)->is_opened;
+		}
+	}
+	return count;
+}
+
+static char * test_budgeted_cascade(void) {
+	uint8_t *budget_buffer = malloc(minesweeper_minimum_buffer_size(width, height));
+	uint8_t *reference_buffer = malloc(minesweeper_minimum_buffer_size(width, height));
+	uint8_t *checkpoint_buffer;
+	struct minesweeper_game *reference;
+	struct minesweeper_checkpoint *checkpoint;
+	unsigned previous_count, step_count = 0, i;
+	int callback_count = 0;
+	bool is_done;
+
+	puts("Test: Budgeted cascades...");
+	reference = minesweeper_init_with_seed(width, height, 0.05, 0, 11, reference_buffer);
+	minesweeper_open_tile(reference, minesweeper_get_tile_at(reference, 60, 50));
+	game = minesweeper_init_with_seed(width, height, 0.05, 0, 11, budget_buffer);
+	game->tile_update_callback = &callback;
+	game->user_info = &callback_count;
+	is_done = minesweeper_open_tile_with_budget(game, minesweeper_get_tile_at(game, 60, 50), 100);
+	mu_assert("Error: a cascade must stop once its budget is spent.", !is_done && game->opened_tile_count > 1 && game->opened_tile_count < 100 + 3 * (unsigned)width);
+	while (!is_done) {
+		previous_count = game->opened_tile_count;
+		is_done = minesweeper_continue_cascade(game, 100);
+		step_count++;
+		mu_assert("Error: a continued cascade must stay within its budget.", game->opened_tile_count - previous_count < 100 + 3 * (unsigned)width);
+		mu_assert("Error: a cascade must finish in a bounded number of steps.", step_count < (unsigned)(width * height));
+		mu_assert("Error: the opened tile count must be up to date between steps.", game->opened_tile_count == count_opened_tiles(game) && callback_count == (int)game->opened_tile_count);
+		mu_assert("Error: the state must be up to date between steps.", game->state == MINESWEEPER_PLAYING);
+	}
+	mu_assert("Error: a large cascade must take several steps.", step_count > 5);
+	for (i = 0; i < (unsigned)(width * height); i++) {
+		mu_assert("Error: a budgeted cascade must open the same tiles as a normal one.", game->tiles[i].is_opened == reference->tiles[i].is_opened);
+	}
+	mu_assert("Error: a finished cascade must have nothing left to do.", minesweeper_continue_cascade(game, 100) && game->opened_tile_count == reference->opened_tile_count);
+
+	/* Other moves in between, and rolling them back */
+	game = minesweeper_init_with_seed(width, height, 0.05, 0, 11, budget_buffer);
+	checkpoint_buffer = malloc(minesweeper_checkpoint_buffer_size(game, width * height));
+	checkpoint = minesweeper_init_checkpoint(game, width * height, checkpoint_buffer);
+	minesweeper_open_tile_with_budget(game, minesweeper_get_tile_at(game, 60, 50), 100);
+	minesweeper_save_checkpoint(game, checkpoint);
+	minesweeper_continue_cascade(game, 100);
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, 0, 0));
+	mu_assert("Error: opening a tile normally must finish a stopped cascade.", game->cascade.pending_count == 0);
+	minesweeper_rollback(game);
+	minesweeper_release_checkpoint(game);
+	mu_assert("Error: rolling back must restore a stopped cascade.", game->cascade.pending_count > 0);
+	while (!minesweeper_continue_cascade(game, 100))
+		;
+	for (i = 0; i < (unsigned)(width * height); i++) {
+		mu_assert("Error: a cascade continued after rolling back must open the same tiles.", game->tiles[i].is_opened == reference->tiles[i].is_opened);
+	}
+
+	/* Winning in the middle of a cascade */
+	game = minesweeper_init(5, 5, 0.0, budget_buffer);
+	minesweeper_toggle_mine(game, minesweeper_get_tile_at(game, 0, 0));
+	is_done = minesweeper_open_tile_with_budget(game, minesweeper_get_tile_at(game, 4, 4), 1);
+	while (!is_done) {
+		mu_assert("Error: the game must be won exactly when the last tile is opened.", (game->state == MINESWEEPER_WIN) == (game->opened_tile_count == 24));
+		is_done = minesweeper_continue_cascade(game, 1);
+	}
+	mu_assert("Error: a finished cascade must win the game.", game->state == MINESWEEPER_WIN && game->opened_tile_count == 24);
+
+	/* Starting cascades all over the board, until more tiles are pending than fit in the queue */
+	game = minesweeper_init(32, 32, 0.0, budget_buffer);
+	for (i = 0; i < 32 * 32; i += 4) {
+		if (i / 32 % 4 == 0)
+			minesweeper_open_tile_with_budget(game, minesweeper_get_tile_at(game, i % 32, i / 32), 1);
+	}
+	mu_assert("Error: the queue of pending tiles must be able to overflow.", game->cascade.has_unqueued);
+	while (!minesweeper_continue_cascade(game, 10))
+		;
+	mu_assert("Error: tiles that didn't fit in the queue must still be cascaded.", game->state == MINESWEEPER_WIN && count_opened_tiles(game) == 32 * 32);
+
+	free(checkpoint_buffer);
+	free(reference_buffer);
+	free(budget_buffer);
+	return 0;
+}
+
+static char * test_replays(void) {
+	uint8_t *buffer = malloc(minesweeper_buffer_size_with_options(EXPERT_WIDTH, EXPERT_HEIGHT, MINESWEEPER_DEFERRED_GENERATION));
+	uint8_t *other_buffer = malloc(minesweeper_buffer_size_with_options(EXPERT_WIDTH, EXPERT_HEIGHT, 0));
+	struct minesweeper_action actions[16][EXPERT_WIDTH * EXPERT_HEIGHT + 1];
+	uint32_t timestamps[16][EXPERT_WIDTH * EXPERT_HEIGHT + 1];
+	struct minesweeper_replay replays[16];
+	enum minesweeper_replay_verdict verdicts[16];
+	struct minesweeper_action other_actions[10];
+	struct minesweeper_tile *adjacent_tiles[8];
+	struct minesweeper_replay replay;
+	struct minesweeper_game *other;
+	size_t count;
+	unsigned i;
+
+	puts("Test: Replay verification...");
+	game = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, 0, 42, buffer);
+	other = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, 0, 42, other_buffer);
+	for (i = 0; i < EXPERT_WIDTH * EXPERT_HEIGHT; i++) {
+		mu_assert("Error: the same seed must give the same board.", game->tiles[i].has_mine == other->tiles[i].has_mine);
+	}
+
+	count = record_winning_replay(1, buffer, &replay, actions[0], timestamps[0]);
+	mu_assert("Error: the recorded game must be won.", replay.claimed_state == MINESWEEPER_WIN);
+	mu_assert("Error: a genuine replay must be valid.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_VALID);
+	replay.claimed_state = MINESWEEPER_PLAYING;
+	mu_assert("Error: a replay claiming the wrong state must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_WRONG_STATE);
+	replay.claimed_state = MINESWEEPER_WIN;
+	replay.claimed_time--;
+	mu_assert("Error: a replay claiming the wrong time must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_WRONG_TIME);
+	replay.claimed_time++;
+	actions[0][count] = actions[0][0];
+	timestamps[0][count] = timestamps[0][count - 1];
+	replay.action_count++;
+	mu_assert("Error: actions after a won game must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_ACTION_AFTER_END);
+	replay.action_count--;
+	timestamps[0][1] = 0;
+	mu_assert("Error: timestamps going backwards must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_TIME_WENT_BACKWARDS);
+	timestamps[0][1] = timestamps[0][0];
+	actions[0][1].x = EXPERT_WIDTH;
+	mu_assert("Error: out of bounds actions must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_INVALID_ACTION);
+	actions[0][1].x = 0;
+	replay.options = MINESWEEPER_TORUS;
+	replay.width = replay.height = 2;
+	mu_assert("Error: a torus that's too small must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_INVALID_BOARD);
+	replay.options = 0;
+	replay.width = replay.height = 70000;
+	mu_assert("Error: a board with too many tiles must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_INVALID_BOARD && minesweeper_replay_buffer_size(&replay) == 0);
+	replay.width = EXPERT_WIDTH;
+	replay.height = EXPERT_HEIGHT;
+	replay.mine_density = 2.0f;
+	mu_assert("Error: a mine density above 1 must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_INVALID_BOARD);
+	replay.mine_density = EXPERT_DENSITY;
+	replay.options = MINESWEEPER_DEFERRED_GENERATION;
+
+	/* Actions the game would ignore */
+	other_actions[0] = actions[0][0];
+	other_actions[1] = actions[0][0];
+	replay.actions = other_actions;
+	replay.action_count = 2;
+	replay.timestamps = NULL;
+	mu_assert("Error: opening an opened tile without flags around it must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_TILE_ALREADY_OPENED);
+	other_actions[1].type = MINESWEEPER_ACTION_TOGGLE_FLAG;
+	mu_assert("Error: flagging an opened tile must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_TILE_ALREADY_OPENED);
+	other_actions[0].type = MINESWEEPER_ACTION_TOGGLE_FLAG;
+	other_actions[1].type = MINESWEEPER_ACTION_OPEN;
+	mu_assert("Error: opening a flagged tile must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_OPENED_FLAGGED_TILE);
+	other_actions[1].type = MINESWEEPER_ACTION_SPACE;
+	mu_assert("Error: unflagging a tile must be valid.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_WRONG_STATE);
+
+	/* Opening an opened number with all its adjacent mines flagged quick-opens */
+	game = minesweeper_init_with_seed(EXPERT_WIDTH, EXPERT_HEIGHT, EXPERT_DENSITY, MINESWEEPER_DEFERRED_GENERATION, replay.seed, other_buffer);
+	minesweeper_open_tile(game, minesweeper_get_tile_at(game, actions[0][0].x, actions[0][0].y));
+	for (i = 0; game->tiles[i].adjacent_mine_count == 0 || !game->tiles[i].is_opened; i++)
+		;
+	minesweeper_get_adjacent_tiles(game, &game->tiles[i], adjacent_tiles);
+	other_actions[0] = actions[0][0];
+	replay.action_count = 1;
+	for (count = 0; count < 8; count++) {
+		if (adjacent_tiles[count] != NULL && adjacent_tiles[count]->has_mine) {
+			other_actions[replay.action_count].type = MINESWEEPER_ACTION_TOGGLE_FLAG;
+			minesweeper_get_tile_location(game, adjacent_tiles[count], &other_actions[replay.action_count].x, &other_actions[replay.action_count].y);
+			replay.action_count++;
+		}
+	}
+	other_actions[replay.action_count].type = MINESWEEPER_ACTION_OPEN;
+	other_actions[replay.action_count].x = i % EXPERT_WIDTH;
+	other_actions[replay.action_count].y = i / EXPERT_WIDTH;
+	replay.action_count++;
+	mu_assert("Error: quick-opening an opened tile must be valid.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_WRONG_STATE);
+	replay.action_count -= 2;
+	other_actions[replay.action_count] = other_actions[replay.action_count + 1];
+	replay.action_count++;
+	mu_assert("Error: opening an opened tile with too few flags around it must be rejected.", minesweeper_verify_replay(&replay, buffer) == MINESWEEPER_REPLAY_TILE_ALREADY_OPENED);
+
+	for (i = 0; i < 16; i++) {
+		record_winning_replay(i + 100, buffer, &replays[i], actions[i], timestamps[i]);
+		if (i % 2)
+			replays[i].seed++;
+	}
+	replays[3].options = MINESWEEPER_TORUS;
+	replays[3].width = replays[3].height = 2;
+	mu_assert("Error: replays must be verified on several threads.", minesweeper_verify_replays(replays, 16, verdicts, 4));
+	for (i = 0; i < 16; i++) {
+		mu_assert("Error: verifying on several threads must give the same verdicts.", verdicts[i] == minesweeper_verify_replay(&replays[i], buffer));
+		mu_assert("Error: replays on another board must not be valid.", (verdicts[i] == MINESWEEPER_REPLAY_VALID) == (i % 2 == 0));
+	}
+
+	free(other_buffer);
+	free(buffer);
+	return 0;
+}
+
+struct queue_consumer {
+	struct minesweeper_update_queue *queue;
+	bool *covered;
+	int stop;
+	unsigned region_count;
+};
+
+/**
+ * Pop everything in the queue, marking the tiles it covers.
+ */
+static void drain_queue(struct queue_consumer *consumer) {
+	struct minesweeper_update updates[16];
+	size_t count, i;
+	uint32_t index;
+	while ((count = minesweeper_update_queue_pop(consumer->queue, updates, 16)) > 0) {
+		for (i = 0; i < count; i++) {
+			for (index = updates[i].index; index <= updates[i].last_index; index++) {
+				if (index % width >= updates[i].index % width && index % width <= updates[i].last_index % width)
+					consumer->covered[index] = true;
+			}
+			if (updates[i].is_region)
+				consumer->region_count++;
+		}
+	}
+}
+
+static void *consume_queue(void *context) {
+	struct queue_consumer *consumer = context;
+	while (!__atomic_load_n(&consumer->stop, __ATOMIC_ACQUIRE)) {
+		drain_queue(consumer);
+	}
+	return NULL;
+}
+
+static char * test_update_queue(void) {
+	uint8_t *queue_buffer = malloc(minesweeper_update_queue_buffer_size(64));
+	struct queue_consumer consumer;
+	struct minesweeper_update update;
+	pthread_t thread;
+	int i;
+
+	puts("Test: Update queue...");
+	game = minesweeper_init(width, height, 0.05, game_buffer);
+	mu_assert("Error: a capacity that isn't a power of two must be rejected.", minesweeper_queue_updates(game, 48, queue_buffer) == NULL && minesweeper_queue_updates(game, 0, queue_buffer) == NULL && game->update_queue == NULL);
+	consumer.queue = minesweeper_queue_updates(game, 64, queue_buffer);
+	consumer.covered = calloc(width * height, sizeof(bool));
+	consumer.stop = 0;
+	consumer.region_count = 0;
+
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 3, 3));
+	mu_assert("Error: a flagged tile must be pushed to the queue.", minesweeper_update_queue_pop(consumer.queue, &update, 1) == 1);
+	mu_assert("Error: a queued update must contain the tile's index and state.", update.index == 3u * width + 3 && !update.is_region && update.tile.has_flag);
+	mu_assert("Error: popped updates must be removed from the queue.", minesweeper_update_queue_pop(consumer.queue, &update, 1) == 0);
+	minesweeper_get_tile_at(game, 3, 3)->reserved = true;
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 3, 3));
+	minesweeper_get_tile_at(game, 3, 3)->reserved = false;
+	minesweeper_update_queue_pop(consumer.queue, &update, 1);
+	mu_assert("Error: queued tiles must not expose the internal reserved bit.", !update.tile.reserved);
+
+	/* The cascade from a zero tile overflows the queue while the consumer drains it */
+	for (i = width * height / 2; game->tiles[i].has_mine || game->tiles[i].adjacent_mine_count > 0; i++)
+		;
+	mu_assert("Error: could not start consumer thread.", pthread_create(&thread, NULL, consume_queue, &consumer) == 0);
+	minesweeper_open_tile(game, &game->tiles[i]);
+	__atomic_store_n(&consumer.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(thread, NULL);
+
+	drain_queue(&consumer);
+	mu_assert("Error: a pending dirty region must be pushed when the queue has room.", minesweeper_update_queue_flush(consumer.queue));
+	drain_queue(&consumer);
+	mu_assert("Error: a cascade larger than the queue must be pushed as a dirty region.", consumer.region_count > 0);
+	for (i = 0; i < width * height; i++) {
+		mu_assert("Error: every opened tile must be covered by a queued update.", !game->tiles[i].is_opened || consumer.covered[i]);
+	}
+
+	free(consumer.covered);
+	free(queue_buffer);
+	game->update_queue = NULL;
+	return 0;
+}
+
+static bool tiles_look_equal(struct minesweeper_tile *a, struct minesweeper_tile *b) {
+	if (a->is_opened != b->is_opened)
+		return false;
+	if (a->is_opened)
+		return a->has_mine == b->has_mine && a->adjacent_mine_count == b->adjacent_mine_count;
+	return a->has_flag == b->has_flag;
+}
+
+static char * test_delta_sync(void) {
+	uint8_t *mirror_buffer = malloc(minesweeper_buffer_size_with_options(width, height, MINESWEEPER_TRACK_ADJACENT_FLAGS));
+	uint8_t *labelled_buffer = malloc(minesweeper_buffer_size_with_options(width, height, MINESWEEPER_LABEL_ZERO_REGIONS));
+	uint8_t *tracker_buffer = malloc(minesweeper_change_tracker_buffer_size(width, height));
+	uint8_t *message = malloc(MINESWEEPER_DELTA_HEADER_SIZE + width * height * 11);
+	struct minesweeper_game *mirror;
+	size_t size;
+	uint32_t sequence;
+	int i;
+
+	puts("Test: Delta sync...");
+	game = minesweeper_init(width, height, 0.05, game_buffer);
+	mirror = minesweeper_init_with_options(width, height, 0.0, MINESWEEPER_TRACK_ADJACENT_FLAGS, mirror_buffer);
+	minesweeper_track_changes(game, tracker_buffer);
+	minesweeper_set_cursor(game, width / 2, height / 2);
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 3, 3));
+	minesweeper_open_tile(game, game->selected_tile);
+	mu_assert("Error: opened tiles and flags must be recorded by the change tracker.", game->change_tracker->changed_tile_count == game->opened_tile_count + 1);
+
+	size = minesweeper_delta_encode(game, 1, message, minesweeper_delta_max_size(game));
+	mu_assert("Error: encoding must succeed with a buffer of minesweeper_delta_max_size().", size >= MINESWEEPER_DELTA_HEADER_SIZE);
+	mu_assert("Error: encoding must clear the change tracker.", game->change_tracker->changed_tile_count == 0);
+	mu_assert("Error: a valid delta must decode.", minesweeper_delta_decode(mirror, message, size, &sequence));
+	mu_assert("Error: the decoded sequence number must match the encoded one.", sequence == 1);
+	mu_assert("Error: counters and state must be synced.", mirror->opened_tile_count == game->opened_tile_count && mirror->flag_count == 1 && mirror->state == game->state);
+	for (i = 0; i < width * height; i++) {
+		mu_assert("Error: every tile of the mirror must look like the original after decoding.", tiles_look_equal(&game->tiles[i], &mirror->tiles[i]));
+	}
+	mu_assert("Error: flags must be counted on the tiles adjacent to them in the mirror.", mirror->adjacent_flag_counts[2 * width + 2] == 1);
+	mu_assert("Error: a mirror with labelled zero regions must be rejected.", !minesweeper_delta_decode(minesweeper_init_with_options(width, height, 0.0, MINESWEEPER_LABEL_ZERO_REGIONS, labelled_buffer), message, size, NULL));
+
+	minesweeper_toggle_flag(game, minesweeper_get_tile_at(game, 3, 3));
+	size = minesweeper_delta_encode(game, 2, message, minesweeper_delta_max_size(game));
+	mu_assert("Error: a single changed tile must encode to a single short run.", size == MINESWEEPER_DELTA_HEADER_SIZE + 4);
+	mu_assert("Error: a truncated delta must be rejected.", !minesweeper_delta_decode(mirror, message, size - 1, NULL));
+	mu_assert("Error: a valid delta must decode.", minesweeper_delta_decode(mirror, message, size, &sequence));
+	mu_assert("Error: removed flags must be synced.", !minesweeper_get_tile_at(mirror, 3, 3)->has_flag && mirror->flag_count == 0);
+	mu_assert("Error: the visible hash of the mirror must match the original.", mirror->visible_hash == game->visible_hash);
+	mu_assert("Error: removed flags must no longer be counted in the mirror.", mirror->adjacent_flag_counts[2 * width + 2] == 0);
+
+	/* A gap whose fifth varint byte has bits beyond 32 */
+	message[MINESWEEPER_DELTA_HEADER_SIZE] = message[MINESWEEPER_DELTA_HEADER_SIZE + 1] = 0x80;
+	message[MINESWEEPER_DELTA_HEADER_SIZE + 2] = message[MINESWEEPER_DELTA_HEADER_SIZE + 3] = 0x80;
+	message[MINESWEEPER_DELTA_HEADER_SIZE + 4] = 0x10;
+	message[MINESWEEPER_DELTA_HEADER_SIZE + 5] = 0x01;
+	message[MINESWEEPER_DELTA_HEADER_SIZE + 6] = MINESWEEPER_DELTA_FLAGGED;
+	mu_assert("Error: a varint that doesn't fit in 32 bits must be rejected.", !minesweeper_delta_decode(mirror, message, MINESWEEPER_DELTA_HEADER_SIZE + 7, NULL));
+
+	/* A state past the last one in enum minesweeper_game_state */
+	size = minesweeper_delta_encode(game, 3, message, minesweeper_delta_max_size(game));
+	message[4] = MINESWEEPER_GAME_OVER + 1;
+	mu_assert("Error: an unknown game state must be rejected.", !minesweeper_delta_decode(mirror, message, size, NULL));
+
+	/* Every other tile flagged, which makes the most runs */
+	game = minesweeper_init(width, height, 0.05, game_buffer);
+	mirror = minesweeper_init_with_options(width, height, 0.0, MINESWEEPER_TRACK_ADJACENT_FLAGS, mirror_buffer);
+	minesweeper_track_changes(game, tracker_buffer);
+	for (i = 0; i < width * height; i += 2) {
+		minesweeper_toggle_flag(game, &game->tiles[i]);
+	}
+	size = minesweeper_delta_encode(game, 4, message, minesweeper_delta_max_size(game));
+	mu_assert("Error: separate runs must fit in minesweeper_delta_max_size().", size >= MINESWEEPER_DELTA_HEADER_SIZE);
+	mu_assert("Error: a delta with separate runs must decode.", minesweeper_delta_decode(mirror, message, size, NULL));
+	mu_assert("Error: separate runs must sync every flag.", mirror->visible_hash == game->visible_hash && mirror->flag_count == game->flag_count);
+
+	free(message);
+	free(labelled_buffer);
+	free(tracker_buffer);
+	free(mirror_buffer);
+	return 0;
+}
+
 static char * all_tests(void) {
 	mu_run_test(test_init);
 	mu_run_test(test_get_tile);
@@ -244,6 +1524,24 @@ static char * all_tests(void) {
 	mu_run_test(test_cursor_movement);
 	mu_run_test(test_space_flag_tile);
 	mu_run_test(test_space_open_tile);
+	mu_run_test(test_delta_sync);
+	mu_run_test(test_adjacent_flag_counts);
+	mu_run_test(test_flags_stop_cascade);
+	mu_run_test(test_cascade_moving_up);
+	mu_run_test(test_parallel_cascade);
+	mu_run_test(test_zero_regions);
+	mu_run_test(test_update_queue);
+	mu_run_test(test_deferred_generation);
+	mu_run_test(test_checkpoints);
+	mu_run_test(test_batched_actions);
+	mu_run_test(test_replays);
+	mu_run_test(test_metrics);
+	mu_run_test(test_hints);
+	mu_run_test(test_cursor_jumps);
+	mu_run_test(test_topologies);
+	mu_run_test(test_zobrist_hashes);
+	mu_run_test(test_overview);
+	mu_run_test(test_budgeted_cascade);
 	return 0;
 }
  
@@ -8,6 +8,7 @@
 #define assertNoException(MESSAGE, CODE) do {try {CODE; assertTrue("", true);} catch (...) {assertTrue(MESSAGE, false);}} while(0)
 
 #include <iostream>
+#include <vector>
 
 int tests_run = 0;
 unsigned int width = 120;
@@ -20,6 +21,7 @@ static char * test_init() {
 	Minesweeper::Game game = Minesweeper::Game(width, height, 1.0);
 	assertTrue("Error: after init, state must be pending_start", game.state() == MINESWEEPER_PENDING_START);
 	assertTrue("Error: after init, width and height must be returned correctly", game.width() == width && game.height() == height);
+	assertException("Error: a torus that's too small should throw an exception.", Minesweeper::Game(2, 2, 0.0, MINESWEEPER_TORUS));
 	return 0;
 }
 
@@ -197,6 +199,96 @@ static char * test_space_open_tile() {
   return 0;
 }
 
+static char * test_checkpoints() {
+	puts("Test: Checkpoints...");
+	Minesweeper::Game game = Minesweeper::Game(width, height, 0.0);
+	game.tileAt(0, 0).toggleMine();
+	game.tileAt(10, 10).toggleFlag();
+	game.tileAt(5, 5).open();
+	unsigned openedTileCount = game.openedTileCount();
+	assertException("Error: rolling back without a checkpoint should throw an exception.", game.rollback());
+
+	game.saveCheckpoint();
+	game.tileAt(0, 0).open();
+	assertTrue("Error: opening a mine after a checkpoint should end the game.", game.state() == MINESWEEPER_GAME_OVER);
+	assertTrue("Error: rolling back should succeed.", game.rollback());
+	assertTrue("Error: rolling back should restore the state.", game.state() == MINESWEEPER_PLAYING && game.openedTileCount() == openedTileCount);
+	assertFalse("Error: rolling back should close opened tiles.", game.tileAt(0, 0).isOpened());
+
+	game.saveCheckpoint();
+	game.tileAt(0, 0).toggleFlag();
+	game.releaseCheckpoint();
+	assertTrue("Error: rolling back past a released checkpoint should succeed.", game.rollback());
+	assertFalse("Error: changes after a released checkpoint should be rolled back.", game.tileAt(0, 0).hasFlag());
+	game.releaseCheckpoint();
+	assertException("Error: releasing without a checkpoint should throw an exception.", game.releaseCheckpoint());
+	return 0;
+}
+static char * test_move_semantics() {
+	puts("Test: Moving games...");
+	std::vector<Minesweeper::Game> games;
+	std::vector<Minesweeper::Game *> callbackGames;
+	for (unsigned i = 0; i < 10; i++) {
+		games.push_back(Minesweeper::Game(20, 20, 0.0));
+		games.back().tileUpdateCallback = [&callbackGames](Minesweeper::Game &game, Minesweeper::Tile&) { callbackGames.push_back(&game); };
+	}
+	games[0].tileAt(0, 0).toggleFlag();
+	assertTrue("Error: a callback should reach a game after it was moved.", callbackGames.size() == 1 && callbackGames[0] == &games[0]);
+
+	games[0].saveCheckpoint();
+	games[0].tileAt(5, 5).open();
+	Minesweeper::Game moved = std::move(games[0]);
+	assertTrue("Error: a moved game should keep its board.", moved.openedTileCount() == 20 * 20 - 1);
+	assertTrue("Error: a moved game should keep its checkpoints.", moved.rollback() && moved.openedTileCount() == 0);
+
+	callbackGames.clear();
+	swap(moved, games[1]);
+	games[1].tileAt(0, 0).toggleFlag();
+	moved.tileAt(0, 0).toggleFlag();
+	assertTrue("Error: callbacks should reach the right games after swapping.", callbackGames.size() == 2 && callbackGames[0] == &games[1] && callbackGames[1] == &moved);
+	assertFalse("Error: swapping should swap the boards.", games[1].tileAt(0, 0).hasFlag() || !moved.tileAt(0, 0).hasFlag());
+	return 0;
+}
+
+struct CountingResource: std::pmr::memory_resource {
+	size_t allocated = 0;
+
+	void *do_allocate(size_t bytes, size_t alignment) override {
+		allocated += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+		allocated -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+		return this == &other;
+	}
+};
+
+static char * test_buffers() {
+	puts("Test: Game buffers...");
+	std::vector<uint8_t> buffer(Minesweeper::Game::bufferSize(width, height));
+	{
+		Minesweeper::Game game(width, height, 0.1, 0, buffer.data(), buffer.size());
+		game.tileAt(0, 0).open();
+		assertTrue("Error: a game should be playable in a caller-provided buffer.", game.width() == width && game.state() == MINESWEEPER_PLAYING);
+		assertTrue("Error: a game should be stored in the caller-provided buffer.", ((minesweeper_game *)buffer.data())->state == MINESWEEPER_PLAYING);
+	}
+	assertException("Error: a buffer that's too small should throw an exception.", Minesweeper::Game(width, height, 0.1, 0, buffer.data(), buffer.size() - 1));
+
+	CountingResource resource;
+	{
+		Minesweeper::Game game(width, height, 0.1, 0, &resource);
+		assertTrue("Error: a game should be allocated from its memory resource.", resource.allocated == Minesweeper::Game::bufferSize(width, height));
+		game.saveCheckpoint(16);
+		assertTrue("Error: checkpoints should be allocated from the game's memory resource.", resource.allocated > Minesweeper::Game::bufferSize(width, height));
+	}
+	assertTrue("Error: everything allocated from a memory resource should be returned to it.", resource.allocated == 0);
+	return 0;
+}
 
 static char * all_tests() {
 	mu_run_test(test_init);
@@ -212,6 +304,9 @@ static char * all_tests() {
 	mu_run_test(test_cursor_movement);
 	mu_run_test(test_space_flag_tile);
 	mu_run_test(test_space_open_tile);
+	mu_run_test(test_checkpoints);
+	mu_run_test(test_move_semantics);
+	mu_run_test(test_buffers);
 	return 0;
 }
  